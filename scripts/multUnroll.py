@@ -1,32 +1,195 @@
-import sys
-MASKS = int(sys.argv[1])
-
-def shares_size(i, qty):
-    if(i < MASKS-1):
-        return qty+"/"+str(MASKS)
-    return qty + " - (" + qty + "/" + str(MASKS) + ")*" + str(i)
-
-print("// MULTIPLICATION - PART 1")
-for i in range(0, MASKS):
-    print("memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);")
-    print("fast_convolution_mult(raw_temp+("+str(i)+"*(VEC_N_SIZE_64/" + str(MASKS) + ")),\n\t\t\t\t\t  a1+("+str(i)+"*(weight/" + str(MASKS) +")), a2+("+str(i)+"*(VEC_N_SIZE_64/" + str(MASKS) + ")),\n\t\t\t\t\t  "+ shares_size(i, "weight") + ", " + shares_size(i, "VEC_N_SIZE_64") + ");")
-    print("reduce(o->s"+str(i)+", raw_temp);")
-
-print("// MULTIPLICATION - PART 2")
-for i in range(0, MASKS):
-    for j in range(i+1, MASKS):
-        print("shake_prng(seed, SEED_BYTES);")
-        print("seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);")
-        print("vect_set_random_fixed_weight(&mask_seedexpander, s, weight);")
-        print("memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);")
-        print("fast_convolution_mult(raw_temp+("+str(j)+"*(VEC_N_SIZE_64/" + str(MASKS) + ")),\n\t\t\t\t\t  a1+("+str(i)+"*(weight/" + str(MASKS) +")), a2+("+str(j)+"*(VEC_N_SIZE_64/" + str(MASKS) + ")),\n\t\t\t\t\t  " + shares_size(i, "weight") + ", " + shares_size(j, "VEC_N_SIZE_64") + ");")
-        print("reduce(temp1, raw_temp);")
-        print("vect_add(temp1, temp1, s, VEC_N_SIZE_64);")
-        print("memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);")
-        print("fast_convolution_mult(raw_temp+("+str(i)+"*(VEC_N_SIZE_64/" + str(MASKS) + ")),\n\t\t\t\t\t  a1+("+str(j)+"*(weight/" + str(MASKS) +")), a2+("+str(i)+"*(VEC_N_SIZE_64/" + str(MASKS) + ")),\n\t\t\t\t\t  " + shares_size(j, "weight") + ", " + shares_size(i, "VEC_N_SIZE_64") + ");")
-        print("reduce(temp2, raw_temp);")
-        print("vect_add(s1, temp1, temp2, VEC_N_SIZE_64);")
-        print("vect_add(o->s"+str(i)+", o->s"+str(i)+", s, VEC_N_SIZE_64);")
-        print("vect_add(o->s"+str(j)+", o->s"+str(j)+", s1, VEC_N_SIZE_64);")
-        print()
+import argparse
+import re
 
+TABLE = 16
+WORD = 64
+
+
+def shares_size(masks, i, qty):
+    if(i < masks-1):
+        return qty+"/"+str(masks)
+    return qty + " - (" + qty + "/" + str(masks) + ")*" + str(i)
+
+
+def print_body(masks):
+    """Prints the unrolled body of the generic safe_mul_planned, as found in src/fields/gf2x.c"""
+    print("// MULTIPLICATION - PART 1")
+    print("shares_init(o);")
+    for i in range(0, masks):
+        print("mul_plan_apply(o->s[" + str(i) + "], plan, a1+("+str(i)+"*(weight/" + str(masks) +")), "+ shares_size(masks, i, "weight") + ", "+str(i)+");")
+
+    print("// MULTIPLICATION - PART 2")
+    for i in range(0, masks):
+        for j in range(i+1, masks):
+            print("shares_mask_cross_term(s, weight);")
+            print("mask_add(o->s[" + str(i) + "], o->s[" + str(j) + "], s);")
+            print("mul_plan_apply(o->s[" + str(j) + "], plan, a1+("+str(i)+"*(weight/" + str(masks) +")), " + shares_size(masks, i, "weight") + ", "+str(j)+");")
+            print("mul_plan_apply(o->s[" + str(j) + "], plan, a1+("+str(j)+"*(weight/" + str(masks) +")), " + shares_size(masks, j, "weight") + ", "+str(i)+");")
+            print()
+
+
+def read_parameters(path, seclvl):
+    """Returns the parameters of HQC-seclvl defined in parameters.h"""
+    text = open(path).read()
+    block = re.search(r"#(?:el)?if SECURITY_LEVEL == " + str(seclvl) + r"\b(.*?)(?=#elif|#endif)", text, re.S).group(1)
+    params = {}
+    for name in ["PARAM_N", "PARAM_OMEGA", "PARAM_OMEGA_R"]:
+        params[name] = int(re.search(r"#define\s+" + name + r"\s+(\d+)", block).group(1))
+    return params
+
+
+class Config:
+    """Sizes of the multiplication of one security level and one number of shares, as computed by gf2x.c"""
+
+    def __init__(self, params, masks):
+        self.n = params["PARAM_N"]
+        self.words = (self.n + 63) // 64
+        self.masks = masks
+        self.weights = sorted({params["PARAM_OMEGA"], params["PARAM_OMEGA_R"]})
+
+    def slice(self, j):
+        """Offset and size in words of the slice j of the dense operand, and the first word of its table"""
+        offset = j * (self.words // self.masks)
+        size = self.words // self.masks if j < self.masks - 1 else self.words - offset
+        return offset, size, TABLE * (offset + j)
+
+    def part(self, weight, i):
+        """First coordinate and number of coordinates of the part i of a sparse operand"""
+        first = i * (weight // self.masks)
+        count = weight // self.masks if i < self.masks - 1 else weight - first
+        return first, count
+
+
+def emit_cyclic(out, cfg, name, offset, size, count):
+    """table_accumulate_cyclic with every size, offset and trip count replaced by its value"""
+    n = cfg.n
+    units = 4 * (size + 1)
+    top = n >> 4
+    up = (n + 0xf) & ~0xf
+    top_mask = (1 << (n & 0xf)) - 1
+    shift = "" if offset == 0 else " + " + str(64 * offset) + "U"
+
+    out.append("static void " + name + "(uint64_t *o, const uint32_t *a1, const uint64_t *table, const gf2x_kernels_t *kernels) {")
+    out.append("    uint8_t *res = (uint8_t *) o;")
+    out.append("")
+    out.append("    for (size_t i = 0; i < " + str(count) + "; i++) {")
+    out.append("        uint32_t pos = a1[i]" + shift + ";")
+    out.append("        pos -= " + str(n) + "U & -(uint32_t) (pos >= " + str(n) + "U);")
+    out.append("")
+    out.append("        const size_t q = pos >> 4;")
+    out.append("        const uint8_t *row = (const uint8_t *) (table + (pos & 0xf) * " + str(size + 1) + ");")
+    out.append("        if (" + str(top) + " - q < " + str(units) + ") {")
+    out.append("            uint16_t a, b;")
+    out.append("")
+    out.append("            kernels->span_xor(res + 2 * q, row, " + str(top) + " - q);")
+    out.append("            memcpy(&a, res + " + str(2 * top) + ", 2);")
+    out.append("            memcpy(&b, row + 2 * (" + str(top) + " - q), 2);")
+    out.append("            a ^= b & " + hex(top_mask) + ";")
+    out.append("            memcpy(res + " + str(2 * top) + ", &a, 2);")
+    out.append("        } else {")
+    out.append("            kernels->span_xor(res + 2 * q, row, " + str(units) + ");")
+    out.append("        }")
+    out.append("")
+    out.append("        const uint32_t wrap = pos + " + str(up - n) + "U;")
+    out.append("        const size_t skip = " + str(up >> 4) + " - (wrap >> 4);")
+    out.append("        const uint8_t *row_wrap = (const uint8_t *) (table + (wrap & 0xf) * " + str(size + 1) + ");")
+    out.append("        if (skip < " + str(units) + ") {")
+    out.append("            kernels->span_xor(res, row_wrap + 2 * skip, " + str(units) + " - skip < " + str(top + 1) + " ? " + str(units) + " - skip : " + str(top + 1) + ");")
+    out.append("        }")
+    out.append("    }")
+    out.append("}")
+    out.append("")
+    out.append("")
+
+
+def emit_kernels(cfg, seclvl, params):
+    out = []
+    out.append("/**")
+    out.append(" * @file gf2x_kernels.h")
+    out.append(" * @brief Multiplication kernels of HQC-" + str(seclvl) + " with " + str(cfg.masks) + " shares, generated by scripts/multUnroll.py")
+    out.append(" *")
+    out.append(" * Every slice offset, trip count and table stride of the generic code of gf2x.c is replaced by its value.")
+    out.append(" * Included by gf2x.c, do not edit.")
+    out.append(" */")
+    out.append("")
+    out.append("#if SECURITY_LEVEL != " + str(seclvl) + " || MASKS != " + str(cfg.masks) + " || PARAM_N != " + str(cfg.n) + " || PARAM_OMEGA != "
+               + str(params["PARAM_OMEGA"]) + " || PARAM_OMEGA_R != " + str(params["PARAM_OMEGA_R"]) + " || TABLE != " + str(TABLE))
+    out.append("    #error gf2x_kernels.h was generated for another configuration")
+    out.append("#endif")
+    out.append("")
+    out.append("")
+
+    # accumulation of every part of every sparse operand with every slice
+    kernels = set()
+    for weight in cfg.weights:
+        counts = {cfg.part(weight, i)[1] for i in range(cfg.masks)}
+        for count in sorted(counts):
+            for j in range(cfg.masks):
+                offset, size, _ = cfg.slice(j)
+                if (j, count) in kernels:
+                    continue
+                kernels.add((j, count))
+                emit_cyclic(out, cfg, "gen_cyclic_s" + str(j) + "_w" + str(count), offset, size, count)
+
+    # safe_mul_planned
+    for weight in cfg.weights:
+        out.append("static void gen_safe_mul_w" + str(weight) + "(shares_t *o, const mul_plan_t *plan, const uint32_t *a1) {")
+        if cfg.masks > 1:
+            out.append("    uint64_t s[" + str(cfg.words) + "] = {0};")
+            out.append("")
+        out.append("    shares_init(o);")
+        for i in range(cfg.masks):
+            first, count = cfg.part(weight, i)
+            out.append("    gen_cyclic_s" + str(i) + "_w" + str(count) + "(o->s[" + str(i) + "], a1 + " + str(first) + ", plan->table + " + str(cfg.slice(i)[2]) + ", plan->kernels);")
+        for i in range(cfg.masks):
+            for j in range(i + 1, cfg.masks):
+                first_i, count_i = cfg.part(weight, i)
+                first_j, count_j = cfg.part(weight, j)
+                out.append("")
+                out.append("    shares_mask_cross_term(s, " + str(weight) + ");")
+                out.append("    mask_add(o->s[" + str(i) + "], o->s[" + str(j) + "], s);")
+                out.append("    gen_cyclic_s" + str(j) + "_w" + str(count_i) + "(o->s[" + str(j) + "], a1 + " + str(first_i) + ", plan->table + " + str(cfg.slice(j)[2]) + ", plan->kernels);")
+                out.append("    gen_cyclic_s" + str(i) + "_w" + str(count_j) + "(o->s[" + str(j) + "], a1 + " + str(first_j) + ", plan->table + " + str(cfg.slice(i)[2]) + ", plan->kernels);")
+        out.append("}")
+        out.append("")
+        out.append("")
+
+    out.append("/**")
+    out.append(" * @brief safe_mul_planned with the table-based convolution, for the weights of HQC-" + str(seclvl))
+    out.append(" *")
+    out.append(" * @returns 1 if the weight has a kernel, 0 otherwise")
+    out.append(" */")
+    out.append("static int gen_safe_mul(shares_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight) {")
+    out.append("    switch (weight) {")
+    for weight in cfg.weights:
+        out.append("        case " + str(weight) + ":")
+        out.append("            gen_safe_mul_w" + str(weight) + "(o, plan, a1);")
+        out.append("            return 1;")
+    out.append("        default:")
+    out.append("            return 0;")
+    out.append("    }")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Unrolled and specialized multiplication code of the masked HQC")
+    parser.add_argument("masks", type=int, help="number of shares")
+    parser.add_argument("--kernels", nargs=3, metavar=("SECLVL", "PARAMETERS_H", "OUTPUT"),
+                        help="write the kernels of SECLVL, with the parameters read from PARAMETERS_H, to OUTPUT "
+                             "instead of printing the generic body of safe_mul_planned")
+    args = parser.parse_args()
+
+    if args.kernels is None:
+        print_body(args.masks)
+        return
+
+    seclvl, path, output = args.kernels
+    params = read_parameters(path, int(seclvl))
+    code = emit_kernels(Config(params, args.masks), int(seclvl), params)
+    with open(output, "w") as f:
+        f.write(code)
+
+
+if __name__ == "__main__":
+    main()
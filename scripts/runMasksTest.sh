@@ -0,0 +1,9 @@
+#!/bin/zsh
+
+# the unrolled kernels of every number of shares, then the loop-based ones of MASKLVL=0 for 1 to 8 shares
+for MASKLVL in 1 2 3 4 0; do
+    cmake -S .. -B ../build -DSECLVL=$1 -DMODE="TIMING-MASKS" -DCROSSCOMPILE=0 -DVERBOSE=1 -DMASKLVL=$MASKLVL
+    make -C ../build
+    echo "HQC-$1, MASKLVL=$MASKLVL"
+    ../build/hqc-$1-native
+done
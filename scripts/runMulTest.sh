@@ -0,0 +1,8 @@
+#!/bin/zsh
+
+for SECLVL in 128 192 256; do
+    cmake -S .. -B ../build -DSECLVL=$SECLVL -DMODE="TIMING-MUL" -DCROSSCOMPILE=0 -DVERBOSE=1 -DMASKLVL=$1
+    make -C ../build
+    echo "HQC-$SECLVL"
+    ../build/hqc-$SECLVL-native
+done
@@ -0,0 +1,8 @@
+#!/bin/zsh
+
+for SAMPLER in REJECTION CT; do
+    cmake -S .. -B ../build -DSECLVL=$1 -DMODE="TIMING-SAMPLER" -DCROSSCOMPILE=0 -DVERBOSE=1 -DMASKLVL=1 -DSAMPLER=$SAMPLER
+    make -C ../build
+    echo "HQC-$1, $SAMPLER sampler"
+    ../build/hqc-$1-native
+done
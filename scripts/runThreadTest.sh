@@ -0,0 +1,8 @@
+#!/bin/zsh
+
+for MASKLVL in 1 2 3 4; do
+    cmake -S .. -B ../build -DSECLVL=$1 -DMODE="TIMING-THREADS" -DCROSSCOMPILE=0 -DVERBOSE=1 -DMASKLVL=$MASKLVL -DTHREADS=8
+    make -C ../build
+    echo "HQC-$1, $MASKLVL shares"
+    ../build/hqc-$1-native
+done
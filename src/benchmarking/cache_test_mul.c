@@ -0,0 +1,161 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../fields/gf2x.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+#if defined(__linux__) && !defined(CROSSCOMPILE)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_COUNTERS
+#endif
+
+
+
+#ifdef PERF_COUNTERS
+/**
+ * @brief Opens a hardware cache counter of the calling thread, disabled
+ *
+ * @param[in] config The cache event, as in perf_event_attr.config
+ * @returns the file descriptor of the counter, -1 if the kernel or the CPU does not provide it
+ */
+static int counter_open(uint64_t config) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0x00, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counter_start(int fd) {
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static long double counter_stop(int fd) {
+    uint64_t value = 0;
+
+    if (fd < 0) {
+        return -1;
+    }
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &value, sizeof(value)) != sizeof(value)) {
+        return -1;
+    }
+    return (long double) value;
+}
+#endif
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const int ITERATIONS = 1000;
+    const uint16_t widths[] = {0, 64, 128, 256};
+
+    uint8_t seed[SEED_BYTES];
+    uint32_t a1[PARAM_OMEGA_R] = {0};
+    uint64_t a2[VEC_N_SIZE_64] = {0};
+    uint64_t o[VEC_N_SIZE_64] = {0};
+    uint64_t ref[VEC_N_SIZE_64] = {0};
+    seedexpander_state seedexpander;
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    // timers declaration
+    uint32_t start, end;
+    welford_t vect_mul_timer;
+#ifdef PERF_COUNTERS
+    welford_t l1_miss_counter, llc_miss_counter;
+    const int l1_fd = counter_open(PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    const int llc_fd = counter_open(PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#ifdef DEBUG
+    if (l1_fd < 0 || llc_fd < 0) {
+        printf("\r\nCache counters not available, reported as -1 \r\n");
+    }
+#endif
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (size_t k = 0; k < sizeof(widths) / sizeof(widths[0]); k++) {
+        welford_init(&vect_mul_timer);
+#ifdef PERF_COUNTERS
+        welford_init(&l1_miss_counter);
+        welford_init(&llc_miss_counter);
+#endif
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            shake_prng(seed, SEED_BYTES);
+            seedexpander_init(&seedexpander, seed, SEED_BYTES);
+            vect_set_random(&seedexpander, a2);
+            vect_set_random_fixed_weight_by_coordinates(&seedexpander, a1, PARAM_OMEGA_R);
+
+            gf2x_set_tile(widths[k]);
+#ifdef PERF_COUNTERS
+            counter_start(l1_fd);
+            counter_start(llc_fd);
+#endif
+            start = rdtsc();
+            vect_mul(o, a1, a2, PARAM_OMEGA_R);
+            end = rdtsc();
+#ifdef PERF_COUNTERS
+            welford_update(&l1_miss_counter, counter_stop(l1_fd));
+            welford_update(&llc_miss_counter, counter_stop(llc_fd));
+#endif
+            welford_update(&vect_mul_timer, ((long double) (end - start)));
+
+            // the tiled result must match the untiled one
+            gf2x_set_tile(0);
+            vect_mul(ref, a1, a2, PARAM_OMEGA_R);
+            errors += memcmp(o, ref, VEC_N_SIZE_BYTES) != 0;
+        }
+
+#ifdef DEBUG
+        printf("\r\nTile width \r\n%u\r\n", (unsigned) widths[k]);
+        printf("\r\nvect_mul cycles \r\n");
+        welford_print(vect_mul_timer);
+#ifdef PERF_COUNTERS
+        printf("\r\nvect_mul L1D read misses \r\n");
+        welford_print(l1_miss_counter);
+        printf("\r\nvect_mul LLC read misses \r\n");
+        welford_print(llc_miss_counter);
+#endif
+#endif
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
@@ -55,8 +55,8 @@ int main() {
     welford_init(&mul_timer);
 
     // Generate data for the fixed part
-    hqc_pke_keygen(pk_0, sk_0);
-    vect_set_random_from_prng(m_0);
+    hqc_pke_keygen(pk_0, sk_0, hqc_rng_default());
+    vect_set_random_from_prng(hqc_rng_default(), m_0);
     shake256_512_ds(&shake256state, theta_0, (uint8_t*) m_0, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
     seedexpander_init(&sk_seedexpander, sk_0, SEED_BYTES);
     vect_set_random_fixed_weight_by_coordinates(&sk_seedexpander, y_0, PARAM_OMEGA);
@@ -69,7 +69,7 @@ int main() {
 
         // FIXED
         start = rdtsc();
-        hqc_pke_encrypt(u, v, m_0, theta_0, pk_0);
+        hqc_pke_encrypt(u, v, m_0, theta_0, pk_0, hqc_rng_default());
         end = rdtsc();
         welford_update(&enc_timer_0, ((long double) (end - start)));
 
@@ -79,20 +79,20 @@ int main() {
         welford_update(&mul_timer_0, ((long double) (end - start)));
 
         start = rdtsc();
-        hqc_pke_decrypt(m_0, u, v, sk_0);
+        hqc_pke_decrypt(m_0, u, v, sk_0, hqc_rng_default());
         end = rdtsc();
         welford_update(&dec_timer_0, ((long double) (end - start)));
 
         // RANDOM
-        hqc_pke_keygen(pk, sk);
+        hqc_pke_keygen(pk, sk, hqc_rng_default());
 
-        vect_set_random_from_prng(m);
+        vect_set_random_from_prng(hqc_rng_default(), m);
         shake256_512_ds(&shake256state, theta, (uint8_t*) m, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
         seedexpander_init(&sk_seedexpander, sk, SEED_BYTES);
         vect_set_random_fixed_weight_by_coordinates(&sk_seedexpander, y, PARAM_OMEGA);
 
         start = rdtsc();
-        hqc_pke_encrypt(u, v, m, theta, pk);
+        hqc_pke_encrypt(u, v, m, theta, pk, hqc_rng_default());
         end = rdtsc();
         welford_update(&enc_timer, ((long double) (end - start)));
 
@@ -102,7 +102,7 @@ int main() {
         welford_update(&mul_timer, ((long double) (end - start)));
 
         start = rdtsc();
-        hqc_pke_decrypt(m, u, v, sk);
+        hqc_pke_decrypt(m, u, v, sk, hqc_rng_default());
         end = rdtsc();
         welford_update(&dec_timer, ((long double) (end - start)));
     }
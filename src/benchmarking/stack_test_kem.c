@@ -0,0 +1,100 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../lib/shake_prng.h"
+#include "board_config.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef CROSSCOMPILE
+#define STACK_PAINT_BYTES (80 * 1024)
+#else
+#define STACK_PAINT_BYTES (1024 * 1024)
+#endif
+#define STACK_PAINT 0xA5
+
+static volatile uint8_t *painted;
+
+
+
+/**
+ * @brief Fills the STACK_PAINT_BYTES below the frame of the caller with STACK_PAINT
+ */
+__attribute__((noinline))
+static void stack_paint(void) {
+    volatile uint8_t area[STACK_PAINT_BYTES];
+    uintptr_t address = (uintptr_t) area;
+
+    for (size_t i = 0; i < STACK_PAINT_BYTES; i++) {
+        area[i] = STACK_PAINT;
+    }
+    // the area is read back by stack_used once this frame is gone, so its address is kept opaque to the compiler
+    __asm__ volatile("" : "+r"(address));
+    painted = (volatile uint8_t *) address;
+}
+
+
+/**
+ * @brief Returns the bytes of the painted area written since stack_paint, counted from its bottom-most change
+ *
+ * The stack grows downwards, so the deepest frame is the lowest address that does not hold STACK_PAINT anymore.
+ */
+static size_t stack_used(void) {
+    size_t i = 0;
+
+    while (i < STACK_PAINT_BYTES && painted[i] == STACK_PAINT) {
+        i++;
+    }
+    return STACK_PAINT_BYTES - i;
+}
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    static unsigned char pk[PUBLIC_KEY_BYTES];
+    static unsigned char sk[SECRET_KEY_BYTES];
+    static unsigned char ct[CIPHERTEXT_BYTES];
+    static unsigned char key1[SHARED_SECRET_BYTES];
+    static unsigned char key2[SHARED_SECRET_BYTES];
+    size_t keypair_stack, enc_stack, dec_stack;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    stack_paint();
+    crypto_kem_keypair(pk, sk);
+    keypair_stack = stack_used();
+
+    stack_paint();
+    crypto_kem_enc(ct, key1, pk);
+    enc_stack = stack_used();
+
+    stack_paint();
+    crypto_kem_dec(key2, ct, sk);
+    dec_stack = stack_used();
+
+    // the depths are the result of this mode, printed whatever the verbosity
+    printf("\r\nKey generation stack bytes \r\n%u\r\n", (unsigned) keypair_stack);
+    printf("\r\nEncapsulation stack bytes \r\n%u\r\n", (unsigned) enc_stack);
+    printf("\r\nDecapsulation stack bytes \r\n%u\r\n", (unsigned) dec_stack);
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", memcmp(key1, key2, SHARED_SECRET_BYTES) != 0);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return memcmp(key1, key2, SHARED_SECRET_BYTES) != 0;
+}
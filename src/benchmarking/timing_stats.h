@@ -1,5 +1,6 @@
 #pragma once
 #include <math.h>
+#include <stdlib.h>
 
 #ifdef CROSSCOMPILE
 #define  ARM_CM_DEMCR      (*(uint32_t *)0xE000EDFC)
@@ -76,3 +77,26 @@ double welch_t_statistic(const welford_t state1,
 
     return num/den;
 }
+
+static inline
+int samples_compare(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t *) a;
+    const uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* sorts the samples and returns their pct-th percentile */
+static inline
+uint32_t samples_percentile(uint32_t *samples, size_t count, unsigned pct) {
+    qsort(samples, count, sizeof(uint32_t), samples_compare);
+    return samples[(count - 1) * pct / 100];
+}
+
+/* mean of the samples */
+static inline
+uint32_t samples_mean(const uint32_t *samples, size_t count) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += samples[i];
+    return (uint32_t) (sum / count);
+}
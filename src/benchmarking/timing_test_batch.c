@@ -0,0 +1,120 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../fields/gf2x.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+#ifdef CROSSCOMPILE
+#define BATCH_MAX 4
+#else
+#define BATCH_MAX 64
+#endif
+
+static uint32_t a1[BATCH_MAX * PARAM_OMEGA_R];
+static uint64_t o[BATCH_MAX * VEC_N_SIZE_64];
+static shares_t mulres[BATCH_MAX];
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const int ITERATIONS = 100;
+
+    uint8_t seed[SEED_BYTES];
+    uint64_t a2[VEC_N_SIZE_64] = {0};
+    uint64_t ref[VEC_N_SIZE_64] = {0};
+    uint64_t red[VEC_N_SIZE_64] = {0};
+    seedexpander_state seedexpander;
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    // timers declaration
+    uint32_t start, end;
+    welford_t vect_mul_timer, vect_batch_timer, safe_mul_timer, safe_batch_timer;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (size_t count = 1; count <= BATCH_MAX; count <<= 1) {
+        welford_init(&vect_mul_timer);
+        welford_init(&vect_batch_timer);
+        welford_init(&safe_mul_timer);
+        welford_init(&safe_batch_timer);
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            shake_prng(seed, SEED_BYTES);
+            seedexpander_init(&seedexpander, seed, SEED_BYTES);
+            vect_set_random(&seedexpander, a2);
+            for (size_t k = 0; k < count; k++) {
+                vect_set_random_fixed_weight_by_coordinates(&seedexpander, a1 + k * PARAM_OMEGA_R, PARAM_OMEGA_R);
+            }
+
+            // per-product cost of the single multiplications, as a baseline
+            start = rdtsc();
+            for (size_t k = 0; k < count; k++) {
+                vect_mul(o + k * VEC_N_SIZE_64, a1 + k * PARAM_OMEGA_R, a2, PARAM_OMEGA_R);
+            }
+            end = rdtsc();
+            welford_update(&vect_mul_timer, ((long double) (end - start)) / count);
+
+            start = rdtsc();
+            for (size_t k = 0; k < count; k++) {
+                safe_mul(mulres + k, a1 + k * PARAM_OMEGA_R, a2, PARAM_OMEGA_R);
+            }
+            end = rdtsc();
+            welford_update(&safe_mul_timer, ((long double) (end - start)) / count);
+
+            start = rdtsc();
+            vect_mul_batch(o, a1, a2, PARAM_OMEGA_R, count);
+            end = rdtsc();
+            welford_update(&vect_batch_timer, ((long double) (end - start)) / count);
+
+            start = rdtsc();
+            safe_mul_batch(mulres, a1, a2, PARAM_OMEGA_R, count);
+            end = rdtsc();
+            welford_update(&safe_batch_timer, ((long double) (end - start)) / count);
+
+            // the batched results must match the single multiplications
+            for (size_t k = 0; k < count; k++) {
+                vect_mul(ref, a1 + k * PARAM_OMEGA_R, a2, PARAM_OMEGA_R);
+                shares_reduce(red, mulres + k);
+                errors += memcmp(o + k * VEC_N_SIZE_64, ref, VEC_N_SIZE_BYTES) != 0;
+                errors += memcmp(red, ref, VEC_N_SIZE_BYTES) != 0;
+            }
+        }
+
+#ifdef DEBUG
+        printf("\r\nBatch size \r\n%u\r\n", (unsigned) count);
+        printf("\r\nvect_mul (per product) \r\n");
+        welford_print(vect_mul_timer);
+        printf("\r\nvect_mul_batch (per product) \r\n");
+        welford_print(vect_batch_timer);
+        printf("\r\nsafe_mul (per product) \r\n");
+        welford_print(safe_mul_timer);
+        printf("\r\nsafe_mul_batch (per product) \r\n");
+        welford_print(safe_batch_timer);
+#endif
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
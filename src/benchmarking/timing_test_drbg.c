@@ -0,0 +1,198 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../lib/hqc_rng.h"
+#include "../lib/shake_prng.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+#define ITERATIONS 1000
+#define SMALL_SIZES 4
+#define LARGE_BYTES MASK_RNG_BUFFER_BYTES /*!< Bytes of a large request, a refill of the masks */
+#ifdef DRBG_DISABLED
+    #define BACKENDS 1 /*!< SHAKE only: the builds of the board leave the DRBG out */
+#else
+    #define BACKENDS 2
+#endif
+
+static uint32_t small_samples[BACKENDS][SMALL_SIZES][ITERATIONS];
+static uint32_t large_samples[BACKENDS][ITERATIONS];
+#ifndef DRBG_DISABLED
+static uint32_t reseed_samples[ITERATIONS];
+#endif
+static uint8_t output[2][LARGE_BYTES];
+static hqc_rng rng[2];
+static unsigned char pk[PUBLIC_KEY_BYTES];
+static unsigned char sk[SECRET_KEY_BYTES];
+#ifndef DRBG_DISABLED
+static int entropy_calls = 0;
+#endif
+
+
+
+/**
+ * @brief Entropy source that always fails
+ */
+static int entropy_failing(uint8_t *out, size_t outlen) {
+    (void) out;
+    (void) outlen;
+    return -1;
+}
+
+
+
+#ifndef DRBG_DISABLED
+/**
+ * @brief Entropy source that works for its first call only
+ */
+static int entropy_once(uint8_t *out, size_t outlen) {
+    if (entropy_calls++ > 0) {
+        return -1;
+    }
+    memset(out, 0x5A, outlen);
+    return 0;
+}
+#endif
+
+
+
+/**
+ * @brief Checks that a DRBG whose entropy source never worked generates nothing, not even through a fork or the KEM,
+ * and that one seeded once keeps generating when a reseed fails; with DRBG_DISABLED, that no DRBG generates anything
+ *
+ * @returns The number of mismatches
+ */
+static int entropy_failure_errors(void) {
+    uint8_t buffer[64], expected[64];
+    hqc_rng failing, flaky, child;
+    int errors = 0;
+
+    memset(expected, 0xA5, sizeof(expected));
+    memset(buffer, 0xA5, sizeof(buffer));
+    errors += hqc_rng_init_drbg(&failing, entropy_failing, NULL, 0) != -1;
+    errors += hqc_rng_status(&failing) != -1;
+    errors += hqc_rng_bytes(&failing, buffer, sizeof(buffer)) != -1;
+    errors += memcmp(buffer, expected, sizeof(buffer)) != 0;
+#ifndef DRBG_DISABLED
+    errors += drbg_reseed(&failing.drbg, NULL, 0) != -1;
+    errors += hqc_rng_bytes(&failing, buffer, sizeof(buffer)) != -1;
+#endif
+    errors += crypto_kem_keypair_rng(pk, sk, &failing) != -1;
+    hqc_rng_fork(&child, &failing);
+    errors += hqc_rng_bytes(&child, buffer, sizeof(buffer)) != -1;
+    errors += memcmp(buffer, expected, sizeof(buffer)) != 0;
+
+#ifdef DRBG_DISABLED
+    errors += hqc_rng_init_drbg(&flaky, NULL, NULL, 0) != -1;
+    errors += hqc_rng_bytes(&flaky, buffer, sizeof(buffer)) != -1;
+#else
+    entropy_calls = 0;
+    errors += hqc_rng_init_drbg(&flaky, entropy_once, NULL, 0) != 0;
+    errors += drbg_reseed(&flaky.drbg, NULL, 0) != -1;
+    errors += hqc_rng_bytes(&flaky, buffer, sizeof(buffer)) != 0;
+    errors += memcmp(buffer, expected, sizeof(buffer)) == 0;
+    errors += crypto_kem_keypair_rng(pk, sk, &flaky) != 0;
+    // the child of a seeded DRBG whose entropy source fails is seeded by the bytes of its parent
+    hqc_rng_fork(&child, &flaky);
+    errors += hqc_rng_bytes(&child, buffer, sizeof(buffer)) != 0;
+#endif
+
+    return errors;
+}
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const char *names[2] = {"SHAKE", "DRBG"};
+    // the message, the seeds and the shared secret
+    const size_t small_bytes[SMALL_SIZES] = {16, 32, SEED_BYTES, 64};
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+
+    // the SHAKE backend is the stream of shake_prng
+    hqc_rng_init(&rng[0], entropy_input, entropy_input, 128, 64);
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+    hqc_rng_bytes(&rng[0], output[0], LARGE_BYTES);
+    shake_prng(output[1], LARGE_BYTES);
+    errors += memcmp(output[0], output[1], LARGE_BYTES) != 0;
+    hqc_rng_init(&rng[0], entropy_input, entropy_input, 128, 64);
+
+#ifndef DRBG_DISABLED
+    // two DRBGs seeded from the system do not agree
+    errors += hqc_rng_init_drbg(&rng[1], NULL, NULL, 0) != 0;
+    errors += hqc_rng_init_drbg(hqc_rng_default(), NULL, NULL, 0) != 0;
+    hqc_rng_bytes(&rng[1], output[0], LARGE_BYTES);
+    hqc_rng_bytes(hqc_rng_default(), output[1], LARGE_BYTES);
+    errors += memcmp(output[0], output[1], LARGE_BYTES) == 0;
+#endif
+
+    // a DRBG fails closed until its entropy source worked once
+    errors += entropy_failure_errors();
+
+    uint32_t start, end;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (int i = 0; i < ITERATIONS; i++) {
+        for (size_t k = 0; k < BACKENDS; k++) {
+            for (size_t s = 0; s < SMALL_SIZES; s++) {
+                start = rdtsc();
+                hqc_rng_bytes(&rng[k], output[k], small_bytes[s]);
+                end = rdtsc();
+                small_samples[k][s][i] = end - start;
+            }
+
+            start = rdtsc();
+            hqc_rng_bytes(&rng[k], output[k], LARGE_BYTES);
+            end = rdtsc();
+            large_samples[k][i] = end - start;
+        }
+    }
+
+#ifndef DRBG_DISABLED
+    // apart, a reseed discarding the buffer
+    for (int i = 0; i < ITERATIONS; i++) {
+        start = rdtsc();
+        errors += drbg_reseed(&rng[1].drbg, NULL, 0) != 0;
+        end = rdtsc();
+        reseed_samples[i] = end - start;
+    }
+#endif
+
+#ifdef DEBUG
+    for (size_t k = 0; k < BACKENDS; k++) {
+        printf("\r\n%s, small requests: bytes, p50 cycles, p99 cycles \r\n", names[k]);
+        for (size_t s = 0; s < SMALL_SIZES; s++) {
+            printf("%u, %u, %u\r\n", (unsigned) small_bytes[s], samples_percentile(small_samples[k][s], ITERATIONS, 50),
+                   samples_percentile(small_samples[k][s], ITERATIONS, 99));
+        }
+
+        const uint32_t p50 = samples_percentile(large_samples[k], ITERATIONS, 50);
+        printf("\r\n%s, %u-byte requests: p50 cycles, bytes per 1000 cycles \r\n%u, %u\r\n", names[k],
+               (unsigned) LARGE_BYTES, p50, (uint32_t) ((uint64_t) 1000 * LARGE_BYTES / p50));
+    }
+#ifndef DRBG_DISABLED
+    printf("\r\nDRBG reseed: p50 cycles \r\n%u\r\n", samples_percentile(reseed_samples, ITERATIONS, 50));
+#endif
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#else
+    (void) names;
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
@@ -0,0 +1,194 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../lib/fips202x4.h"
+#include "../lib/shake_ds.h"
+#include "../lib/shake_prng.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+#define ITERATIONS 200
+#define BLOCKS 32 /*!< Rate blocks squeezed by every lane in a sample */
+#define BYTES (BLOCKS * SHAKE256_RATE)
+#define KAT_INLEN 200 /*!< Bytes of the long known-answer input, 0, 1, ..., 199 */
+#define KAT_OUTLEN 600 /*!< Bytes squeezed from it */
+
+/* Known answers of SHAKE-256, from an independent implementation: the first 32 bytes of the empty input */
+static const uint8_t kat_empty[32] = {
+    0x46, 0xb9, 0xdd, 0x2b, 0x0b, 0xa8, 0x8d, 0x13,
+    0x23, 0x3b, 0x3f, 0xeb, 0x74, 0x3e, 0xeb, 0x24,
+    0x3f, 0xcd, 0x52, 0xea, 0x62, 0xb8, 0x1b, 0x82,
+    0xb5, 0x0c, 0x27, 0x64, 0x6e, 0xd5, 0x76, 0x2f
+};
+
+/* and the first and last 32 of the KAT_OUTLEN bytes of the long input, over several permutations */
+static const uint8_t kat_long[2][32] = {{
+    0x4e, 0xe1, 0xca, 0x03, 0x27, 0x2b, 0x05, 0xd3,
+    0xbf, 0xb1, 0xe1, 0xc7, 0x9a, 0x96, 0x7f, 0x82,
+    0x3b, 0x9f, 0xc5, 0xe4, 0xbb, 0x39, 0x87, 0xb1,
+    0xba, 0x9e, 0x9c, 0xb5, 0xaf, 0xb0, 0x7a, 0x5e
+}, {
+    0xfd, 0x24, 0x60, 0xf1, 0x82, 0xdd, 0x5a, 0x58,
+    0x26, 0x9c, 0x2e, 0x5d, 0x0b, 0x0d, 0x1c, 0x51,
+    0x30, 0x14, 0xa1, 0xcd, 0xf8, 0xf6, 0x77, 0xd7,
+    0x43, 0x0b, 0x7a, 0x6f, 0x9c, 0x7a, 0x8d, 0x9c
+}};
+
+static uint32_t samples[3][ITERATIONS];
+static uint32_t hash_samples[3][ITERATIONS];
+static uint8_t output[8][BYTES];
+static uint8_t reference[BYTES];
+
+
+/**
+ * @brief Checks shake256 and the lane-wise squeeze, with the permutation of the CPU, against the known answers
+ *
+ * @returns the number of mismatches
+ */
+static int known_answer_errors(void) {
+    uint8_t input[KAT_INLEN], out[KAT_OUTLEN];
+    shake256incctx state;
+    int errors = 0;
+
+    for (size_t i = 0; i < KAT_INLEN; i++) {
+        input[i] = (uint8_t) i;
+    }
+
+    shake256(out, 32, input, 0);
+    errors += memcmp(out, kat_empty, 32) != 0;
+
+    shake256(out, KAT_OUTLEN, input, KAT_INLEN);
+    errors += memcmp(out, kat_long[0], 32) != 0;
+    errors += memcmp(out + KAT_OUTLEN - 32, kat_long[1], 32) != 0;
+
+    shake256_inc_init(&state);
+    shake256_inc_absorb(&state, input, KAT_INLEN);
+    shake256_inc_finalize(&state);
+    shake256_inc_squeeze_lanes(out, KAT_OUTLEN, &state);
+    errors += memcmp(out, kat_long[0], 32) != 0;
+    errors += memcmp(out + KAT_OUTLEN - 32, kat_long[1], 32) != 0;
+
+    return errors;
+}
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const char *names[3] = {"shake256", "shake256x4", "shake256x8"};
+    const size_t lanes[3] = {1, 4, 8};
+
+    uint8_t seed[8][SEED_BYTES];
+    uint8_t *out[8];
+    const uint8_t *in[8];
+    uint8_t theta[3][SHAKE256_512_BYTES], d[3][SHAKE256_512_BYTES];
+    uint64_t m[VEC_K_SIZE_64];
+    shake256incctx state;
+    shake256x4incctx state4;
+    shake256x8incctx state8;
+    int errors = known_answer_errors();
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    for (size_t j = 0; j < 8; j++) {
+        out[j] = output[j];
+        in[j] = seed[j];
+    }
+
+    uint32_t start, end;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (int i = 0; i < ITERATIONS; i++) {
+        shake_prng((uint8_t *) seed, sizeof(seed));
+
+        shake256_inc_init(&state);
+        shake256_inc_absorb(&state, seed[0], SEED_BYTES);
+        shake256_inc_finalize(&state);
+        start = rdtsc();
+        shake256_inc_squeeze_lanes(output[0], BYTES, &state);
+        end = rdtsc();
+        samples[0][i] = end - start;
+
+        shake256x4_inc_init(&state4);
+        shake256x4_inc_absorb(&state4, in, SEED_BYTES);
+        shake256x4_inc_finalize(&state4);
+        start = rdtsc();
+        shake256x4_inc_squeeze(out, BYTES, &state4);
+        end = rdtsc();
+        samples[1][i] = end - start;
+
+        shake256x8_inc_init(&state8);
+        shake256x8_inc_absorb(&state8, in, SEED_BYTES);
+        shake256x8_inc_finalize(&state8);
+        start = rdtsc();
+        shake256x8_inc_squeeze(out, BYTES, &state8);
+        end = rdtsc();
+        samples[2][i] = end - start;
+
+        // every lane squeezes the bytes of the single-lane API, itself checked against the known answers
+        for (size_t j = 0; j < 8; j++) {
+            shake256(reference, BYTES, seed[j], SEED_BYTES);
+            errors += memcmp(reference, output[j], BYTES) != 0;
+        }
+
+        // the G and H hashes of a message, one after the other then side by side on 4 and 2 lanes
+        memcpy(m, seed, VEC_K_SIZE_BYTES);
+        start = rdtsc();
+        shake256_512_ds(&state, theta[0], (uint8_t *) m, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
+        shake256_512_ds(&state, d[0], (uint8_t *) m, VEC_K_SIZE_BYTES, H_FCT_DOMAIN);
+        end = rdtsc();
+        hash_samples[0][i] = end - start;
+
+        uint8_t *gh[4] = {theta[1], d[1], NULL, NULL};
+        const uint8_t *mm[4] = {(uint8_t *) m, (uint8_t *) m, NULL, NULL};
+        const uint8_t domains[4] = {G_FCT_DOMAIN, H_FCT_DOMAIN, 0, 0};
+        start = rdtsc();
+        shake256_512_ds_x4(gh, mm, VEC_K_SIZE_BYTES, domains);
+        end = rdtsc();
+        hash_samples[1][i] = end - start;
+
+        uint8_t *gh2[2] = {theta[2], d[2]};
+        const uint8_t *mm2[2] = {(uint8_t *) m, (uint8_t *) m};
+        start = rdtsc();
+        shake256_512_ds_x2(gh2, mm2, VEC_K_SIZE_BYTES, domains);
+        end = rdtsc();
+        hash_samples[2][i] = end - start;
+
+        for (size_t k = 1; k < 3; k++) {
+            errors += memcmp(theta[0], theta[k], SHAKE256_512_BYTES) != 0;
+            errors += memcmp(d[0], d[k], SHAKE256_512_BYTES) != 0;
+        }
+    }
+
+#ifdef DEBUG
+    for (size_t k = 0; k < 3; k++) {
+        const uint32_t p50 = samples_percentile(samples[k], ITERATIONS, 50);
+
+        printf("\r\n%s, %u lanes: p50 cycles, bytes per 1000 cycles \r\n%u, %u\r\n", names[k], (unsigned) lanes[k],
+               p50, (uint32_t) ((uint64_t) 1000 * lanes[k] * BYTES / p50));
+    }
+    printf("\r\nG and H: p50 cycles one after the other, side by side on 4 lanes, on 2 lanes \r\n%u, %u, %u\r\n",
+           samples_percentile(hash_samples[0], ITERATIONS, 50), samples_percentile(hash_samples[1], ITERATIONS, 50),
+           samples_percentile(hash_samples[2], ITERATIONS, 50));
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#else
+    (void) names;
+    (void) lanes;
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
@@ -0,0 +1,173 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../lib/hqc_rng.h"
+#include "board_config.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "timing_stats.h"
+
+#define THREADS_MAX 8
+#define OPERATIONS 32 /*!< Keygen, encapsulation and decapsulation rounds of every thread */
+#define COLD_SEED_BYTES 48 /*!< Bytes of the seeds of the contexts of the cold start */
+
+/**
+ * A thread of the benchmark, with a context of its own
+ */
+typedef struct {
+    pthread_t thread;
+    hqc_rng rng;
+    uint8_t pk[PUBLIC_KEY_BYTES]; /*!< First public key of the context, computed beforehand on a copy */
+    int errors;
+} worker_t;
+
+static worker_t workers[THREADS_MAX];
+
+
+/**
+ * @brief Seeds the context of thread t of the cold start
+ */
+static void cold_seed(hqc_rng *rng, unsigned t) {
+    uint8_t seed[COLD_SEED_BYTES];
+
+    memset(seed, (int) t, COLD_SEED_BYTES);
+    hqc_rng_init(rng, seed, seed, COLD_SEED_BYTES, 0);
+}
+
+
+/**
+ * @brief First KEM operations of a thread of the cold start, on a context seeded in the thread itself
+ */
+static void *cold_main(void *arg) {
+    worker_t *w = arg;
+    unsigned char sk[SECRET_KEY_BYTES];
+    unsigned char ct[CIPHERTEXT_BYTES];
+    unsigned char key1[SHARED_SECRET_BYTES];
+    unsigned char key2[SHARED_SECRET_BYTES];
+
+    cold_seed(&w->rng, (unsigned) (w - workers));
+    w->errors += crypto_kem_keypair_rng(w->pk, sk, &w->rng) != 0;
+    w->errors += crypto_kem_enc_rng(ct, key1, w->pk, &w->rng) != 0;
+    w->errors += crypto_kem_dec_rng(key2, ct, sk, &w->rng) != 0;
+    w->errors += memcmp(key1, key2, SHARED_SECRET_BYTES) != 0;
+    return NULL;
+}
+
+
+/**
+ * @brief Starts THREADS_MAX threads before anything else runs, so that they select the kernels and the backends
+ * of the process side by side on their first calls, then checks their keys against the ones of the main thread
+ *
+ * @returns the number of mismatches
+ */
+static int cold_start_errors(void) {
+    unsigned char pk[PUBLIC_KEY_BYTES];
+    unsigned char sk[SECRET_KEY_BYTES];
+    hqc_rng rng;
+    int errors = 0;
+
+    for (unsigned t = 0; t < THREADS_MAX; t++) {
+        workers[t].errors = 0;
+        if (pthread_create(&workers[t].thread, NULL, cold_main, &workers[t]) != 0) {
+            return -1;
+        }
+    }
+    for (unsigned t = 0; t < THREADS_MAX; t++) {
+        pthread_join(workers[t].thread, NULL);
+        errors += workers[t].errors;
+
+        cold_seed(&rng, t);
+        crypto_kem_keypair_rng(pk, sk, &rng);
+        errors += memcmp(pk, workers[t].pk, PUBLIC_KEY_BYTES) != 0;
+    }
+    return errors;
+}
+
+
+static void *worker_main(void *arg) {
+    worker_t *w = arg;
+    unsigned char pk[PUBLIC_KEY_BYTES];
+    unsigned char sk[SECRET_KEY_BYTES];
+    unsigned char ct[CIPHERTEXT_BYTES];
+    unsigned char key1[SHARED_SECRET_BYTES];
+    unsigned char key2[SHARED_SECRET_BYTES];
+
+    for (int i = 0; i < OPERATIONS; i++) {
+        crypto_kem_keypair_rng(pk, sk, &w->rng);
+        crypto_kem_enc_rng(ct, key1, pk, &w->rng);
+        crypto_kem_dec_rng(key2, ct, sk, &w->rng);
+
+        // the stream of a context does not depend on the other threads
+        if (i == 0) {
+            w->errors += memcmp(pk, w->pk, PUBLIC_KEY_BYTES) != 0;
+        }
+        w->errors += memcmp(key1, key2, SHARED_SECRET_BYTES) != 0;
+    }
+    return NULL;
+}
+
+
+
+int main() {
+    unsigned char sk[SECRET_KEY_BYTES];
+    hqc_rng parent, copy;
+    struct timespec start, end;
+    double single = 0;
+    // nothing selected yet: the threads of the cold start do it
+    int errors = cold_start_errors();
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+
+#ifdef DEBUG
+    printf("\r\nOnline processors \r\n%ld\r\n", sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+    for (unsigned threads = 1; threads <= THREADS_MAX; threads++) {
+        // a context per thread, forked from the same parent for every thread count
+        hqc_rng_init(&parent, entropy_input, entropy_input, 128, 64);
+        for (unsigned t = 0; t < threads; t++) {
+            hqc_rng_fork(&workers[t].rng, &parent);
+            copy = workers[t].rng;
+            crypto_kem_keypair_rng(workers[t].pk, sk, &copy);
+            workers[t].errors = 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (unsigned t = 1; t < threads; t++) {
+            if (pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]) != 0) {
+                return -1;
+            }
+        }
+        worker_main(&workers[0]);
+        for (unsigned t = 1; t < threads; t++) {
+            pthread_join(workers[t].thread, NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        const double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) * 1e-9;
+        const double rate = threads * OPERATIONS / seconds;
+        if (threads == 1) {
+            single = rate;
+        }
+        for (unsigned t = 0; t < threads; t++) {
+            errors += workers[t].errors;
+        }
+
+#ifdef DEBUG
+        printf("\r\nThreads, KEM operations (keygen, encapsulation and decapsulation) per second, speedup \r\n"
+               "%u, %.1f, %.2f\r\n", threads, rate, rate / single);
+#else
+        (void) single;
+#endif
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+    return errors;
+}
@@ -0,0 +1,266 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../fields/gf2x.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+
+/**
+ * @brief Checks the batched cross-term masks drawn with the rejection kernel of the current instruction set: enough
+ * of them that one batch at least is sampled with it, each of weight PARAM_OMEGA_R below PARAM_N
+ *
+ * @param[in] masks Number of shares
+ * @returns the number of mismatches
+ */
+static int cross_term_errors(unsigned masks) {
+    const unsigned count = masks > 1 ? masks * (masks - 1) / 2 + 1 : 2;
+    uint64_t mask[VEC_N_SIZE_64];
+    int errors = 0;
+
+    for (unsigned k = 0; k < count; k++) {
+        int weight = 0;
+
+        memset(mask, 0x00, VEC_N_SIZE_BYTES);
+        shares_mask_cross_term(mask, PARAM_OMEGA_R);
+        for (int i = 0; i < VEC_N_SIZE_64; i++)
+            weight += __builtin_popcountll(mask[i]);
+        errors += weight != PARAM_OMEGA_R;
+        errors += (mask[VEC_N_SIZE_64 - 1] & ~RED_MASK) != 0;
+    }
+    return errors;
+}
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const int ITERATIONS = 100;
+
+    uint8_t seed[SEED_BYTES];
+    uint32_t a1[PARAM_OMEGA_R] = {0};
+    uint64_t a2[VEC_N_SIZE_64] = {0};
+    uint64_t v[VEC_N1N2_SIZE_64] = {0};
+    uint64_t ref[VEC_N_SIZE_64] = {0};
+    uint64_t red[VEC_N_SIZE_64] = {0};
+    uint64_t fused[VEC_N_SIZE_64] = {0};
+    uint64_t mask[VEC_N_SIZE_64];
+    static shares_t mulres, resized;
+    seedexpander_state seedexpander;
+    unsigned char pk[PUBLIC_KEY_BYTES];
+    unsigned char sk[SECRET_KEY_BYTES];
+    unsigned char ct[CIPHERTEXT_BYTES];
+    unsigned char key1[SHARED_SECRET_BYTES];
+    unsigned char key2[SHARED_SECRET_BYTES];
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    // timers declaration
+    uint32_t start, end;
+    welford_t safe_mul_timer, resize_timer, add_timer, reduce_timer;
+    welford_t fused_timer;
+    welford_t enc_timer, dec_timer, prng_timer, mask_rng_timer;
+    welford_t cross_seedexpander_timer, cross_batch_timer, cross_dense_timer;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    // one mask from the sponge of shake_prng, then from the buffered source with each keystream
+    welford_init(&prng_timer);
+    for (int i = 0; i < ITERATIONS; i++) {
+        start = rdtsc();
+        shake_prng((uint8_t *) mask, VEC_N_SIZE_BYTES);
+        end = rdtsc();
+        welford_update(&prng_timer, ((long double) (end - start)));
+    }
+#ifdef DEBUG
+    printf("\r\nshake_prng, one mask \r\n");
+    welford_print(prng_timer);
+#endif
+    for (mask_rng_backend_t backend = MASK_RNG_SHAKE; backend <= MASK_RNG_AES; backend++) {
+        if (mask_rng_set_backend(backend) != backend) {
+            continue;
+        }
+        welford_init(&mask_rng_timer);
+        for (int i = 0; i < ITERATIONS; i++) {
+            start = rdtsc();
+            mask_rng((uint8_t *) mask, VEC_N_SIZE_BYTES);
+            end = rdtsc();
+            welford_update(&mask_rng_timer, ((long double) (end - start)));
+        }
+#ifdef DEBUG
+        printf("\r\nmask_rng, one mask, %s \r\n", backend == MASK_RNG_AES ? "AES" : "SHAKE");
+        welford_print(mask_rng_timer);
+#endif
+    }
+    mask_rng_set_backend(MASK_RNG_AUTO);
+
+    // every number of shares of the build: all of them with MASKLVL=0, MASKLVL otherwise
+    for (unsigned masks = 1; masks <= 8; masks++) {
+        if (shares_set_masks(masks) != masks) {
+            continue;
+        }
+        welford_init(&safe_mul_timer);
+        welford_init(&resize_timer);
+        welford_init(&add_timer);
+        welford_init(&reduce_timer);
+        welford_init(&fused_timer);
+        welford_init(&enc_timer);
+        welford_init(&dec_timer);
+        welford_init(&cross_seedexpander_timer);
+        welford_init(&cross_batch_timer);
+        welford_init(&cross_dense_timer);
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            shake_prng(seed, SEED_BYTES);
+            seedexpander_init(&seedexpander, seed, SEED_BYTES);
+            vect_set_random(&seedexpander, a2);
+            vect_set_random(&seedexpander, v);
+            vect_set_random_fixed_weight_by_coordinates(&seedexpander, a1, PARAM_OMEGA_R);
+            v[VEC_N1N2_SIZE_64 - 1] &= BITMASK(PARAM_N1N2, 64);
+
+            start = rdtsc();
+            safe_mul(&mulres, a1, a2, PARAM_OMEGA_R);
+            end = rdtsc();
+            welford_update(&safe_mul_timer, ((long double) (end - start)));
+
+            // the sum in a single pass, without writing its shares, before shares_add overwrites the product
+            start = rdtsc();
+            shares_add_reduce(fused, v, NULL, &mulres, VEC_N_SIZE_64);
+            end = rdtsc();
+            welford_update(&fused_timer, ((long double) (end - start)));
+
+            shares_init(&resized);
+            start = rdtsc();
+            shares_resize(&resized, v);
+            end = rdtsc();
+            welford_update(&resize_timer, ((long double) (end - start)));
+
+            start = rdtsc();
+            shares_add(&mulres, &resized, &mulres);
+            end = rdtsc();
+            welford_update(&add_timer, ((long double) (end - start)));
+
+            start = rdtsc();
+            shares_reduce(red, &mulres);
+            end = rdtsc();
+            welford_update(&reduce_timer, ((long double) (end - start)));
+
+            // the shares must add up to v + a1.a2
+            vect_mul(ref, a1, a2, PARAM_OMEGA_R);
+            vect_add(ref, ref, v, VEC_N1N2_SIZE_64);
+            errors += memcmp(red, ref, VEC_N_SIZE_BYTES) != 0;
+            errors += memcmp(fused, ref, VEC_N_SIZE_BYTES) != 0;
+
+            // the masks of the cross terms of one safe_mul: one seedexpander each, batched, dense
+            start = rdtsc();
+            memset(mask, 0x00, VEC_N_SIZE_BYTES);
+            for (unsigned k = 0; k < masks * (masks - 1) / 2; k++) {
+                mask_rng(seed, SEED_BYTES);
+                seedexpander_init(&seedexpander, seed, SEED_BYTES);
+                vect_set_random_fixed_weight(&seedexpander, mask, PARAM_OMEGA_R);
+            }
+            end = rdtsc();
+            welford_update(&cross_seedexpander_timer, ((long double) (end - start)));
+
+            start = rdtsc();
+            memset(mask, 0x00, VEC_N_SIZE_BYTES);
+            for (unsigned k = 0; k < masks * (masks - 1) / 2; k++) {
+                shares_mask_cross_term(mask, PARAM_OMEGA_R);
+            }
+            end = rdtsc();
+            welford_update(&cross_batch_timer, ((long double) (end - start)));
+
+            // the batched masks with the rejection kernel of every instruction set of the CPU
+            for (shares_isa_t isa = SHARES_ISA_SCALAR; isa <= SHARES_ISA_AVX512; isa++) {
+                if (shares_set_isa(isa) == isa) {
+                    errors += cross_term_errors(masks);
+                }
+            }
+            shares_set_isa(SHARES_ISA_AUTO);
+
+            shares_set_refresh(SHARES_REFRESH_DENSE);
+            start = rdtsc();
+            for (unsigned k = 0; k < masks * (masks - 1) / 2; k++) {
+                shares_mask_cross_term(mask, PARAM_OMEGA_R);
+            }
+            end = rdtsc();
+            welford_update(&cross_dense_timer, ((long double) (end - start)));
+
+            // safe_mul with both kinds of cross-term masks, with every multiplication, against vect_mul
+            vect_mul(ref, a1, a2, PARAM_OMEGA_R);
+            for (shares_refresh_t refresh = SHARES_REFRESH_FIXED_WEIGHT; refresh <= SHARES_REFRESH_DENSE; refresh++) {
+                shares_set_refresh(refresh);
+                for (gf2x_mul_t mul = GF2X_MUL_SPARSE; mul <= GF2X_MUL_STREAM; mul++) {
+                    if (gf2x_set_mul(mul) != mul) {
+                        continue;
+                    }
+                    safe_mul(&resized, a1, a2, PARAM_OMEGA_R);
+                    shares_reduce(red, &resized);
+                    errors += memcmp(red, ref, VEC_N_SIZE_BYTES) != 0;
+                }
+            }
+            gf2x_set_mul(GF2X_MUL_DEFAULT);
+            shares_set_refresh(SHARES_REFRESH_FIXED_WEIGHT);
+
+            crypto_kem_keypair(pk, sk);
+
+            start = rdtsc();
+            crypto_kem_enc(ct, key1, pk);
+            end = rdtsc();
+            welford_update(&enc_timer, ((long double) (end - start)));
+
+            start = rdtsc();
+            crypto_kem_dec(key2, ct, sk);
+            end = rdtsc();
+            welford_update(&dec_timer, ((long double) (end - start)));
+
+            errors += memcmp(key1, key2, SHARED_SECRET_BYTES) != 0;
+        }
+
+#ifdef DEBUG
+        printf("\r\nShares \r\n%u\r\n", masks);
+        printf("\r\nsafe_mul \r\n");
+        welford_print(safe_mul_timer);
+        printf("\r\nshares_resize \r\n");
+        welford_print(resize_timer);
+        printf("\r\nshares_add \r\n");
+        welford_print(add_timer);
+        printf("\r\nshares_reduce \r\n");
+        welford_print(reduce_timer);
+        printf("\r\nshares_add_reduce \r\n");
+        welford_print(fused_timer);
+        printf("\r\nCross-term masks, seedexpander \r\n");
+        welford_print(cross_seedexpander_timer);
+        printf("\r\nCross-term masks, batched \r\n");
+        welford_print(cross_batch_timer);
+        printf("\r\nCross-term masks, dense \r\n");
+        welford_print(cross_dense_timer);
+        printf("\r\nEncapsulation \r\n");
+        welford_print(enc_timer);
+        printf("\r\nDecapsulation \r\n");
+        welford_print(dec_timer);
+#endif
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
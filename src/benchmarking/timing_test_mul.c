@@ -0,0 +1,104 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../fields/gf2x.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const int ITERATIONS = 100;
+    const gf2x_mul_t muls[] = {GF2X_MUL_SPARSE, GF2X_MUL_DENSE, GF2X_MUL_BARREL, GF2X_MUL_STREAM};
+    const gf2x_isa_t isas[] = {GF2X_ISA_SCALAR, GF2X_ISA_AVX2, GF2X_ISA_AVX512};
+#ifdef DEBUG
+    const char *mul_names[] = {"auto", "sparse", "dense", "barrel", "stream"};
+    const char *isa_names[] = {"auto", "scalar", "avx2", "avx512"};
+#endif
+
+    uint8_t seed[SEED_BYTES];
+    uint32_t a1[PARAM_OMEGA_R] = {0};
+    uint64_t a2[VEC_N_SIZE_64] = {0};
+    uint64_t o[VEC_N_SIZE_64] = {0};
+    uint64_t ref[VEC_N_SIZE_64] = {0};
+    uint64_t red[VEC_N_SIZE_64] = {0};
+    shares_t mulres;
+    seedexpander_state seedexpander;
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    // timers declaration
+    uint32_t start, end;
+    welford_t vect_mul_timer, safe_mul_timer;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (size_t l = 0; l < sizeof(muls) / sizeof(muls[0]); l++) {
+    for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+        // skip the instruction sets the CPU does not support, and the algorithms the build does not have
+        if (gf2x_set_isa(isas[k]) != isas[k] || gf2x_set_mul(muls[l]) != muls[l]) {
+            continue;
+        }
+
+        welford_init(&vect_mul_timer);
+        welford_init(&safe_mul_timer);
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            shake_prng(seed, SEED_BYTES);
+            seedexpander_init(&seedexpander, seed, SEED_BYTES);
+            vect_set_random(&seedexpander, a2);
+            vect_set_random_fixed_weight_by_coordinates(&seedexpander, a1, PARAM_OMEGA_R);
+
+            start = rdtsc();
+            vect_mul(o, a1, a2, PARAM_OMEGA_R);
+            end = rdtsc();
+            welford_update(&vect_mul_timer, ((long double) (end - start)));
+
+            start = rdtsc();
+            safe_mul(&mulres, a1, a2, PARAM_OMEGA_R);
+            end = rdtsc();
+            welford_update(&safe_mul_timer, ((long double) (end - start)));
+
+            // the unmasked result must match the reference kernel
+            gf2x_set_isa(GF2X_ISA_SCALAR);
+            gf2x_set_mul(GF2X_MUL_SPARSE);
+            vect_mul(ref, a1, a2, PARAM_OMEGA_R);
+            gf2x_set_isa(isas[k]);
+            gf2x_set_mul(muls[l]);
+            shares_reduce(red, &mulres);
+            errors += memcmp(o, ref, VEC_N_SIZE_BYTES) != 0;
+            errors += memcmp(red, ref, VEC_N_SIZE_BYTES) != 0;
+        }
+
+#ifdef DEBUG
+        printf("\r\n%s %s vect_mul \r\n", mul_names[muls[l]], isa_names[isas[k]]);
+        welford_print(vect_mul_timer);
+        printf("\r\n%s %s safe_mul \r\n", mul_names[muls[l]], isa_names[isas[k]]);
+        welford_print(safe_mul_timer);
+#endif
+    }
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
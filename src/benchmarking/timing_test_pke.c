@@ -51,12 +51,12 @@ int main() {
     ledOn();
 #endif
     for(int i = 0; i < ITERATIONS; i++) {
-        hqc_pke_keygen(pk, sk);
+        hqc_pke_keygen(pk, sk, hqc_rng_default());
 
-        vect_set_random_from_prng(m);
+        vect_set_random_from_prng(hqc_rng_default(), m);
         shake256_512_ds(&shake256state, theta, (uint8_t*) m, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
         start = rdtsc();
-        hqc_pke_encrypt(u, v, m, theta, pk);
+        hqc_pke_encrypt(u, v, m, theta, pk, hqc_rng_default());
         end = rdtsc();
         welford_update(&enc_timer, ((long double) (end - start)));
 
@@ -68,7 +68,7 @@ int main() {
         welford_update(&mul_timer, ((long double) (end - start)));
 
         start = rdtsc();
-        hqc_pke_decrypt(m, u, v, sk);
+        hqc_pke_decrypt(m, u, v, sk, hqc_rng_default());
         end = rdtsc();
         welford_update(&dec_timer, ((long double) (end - start)));
     }
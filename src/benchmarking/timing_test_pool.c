@@ -0,0 +1,99 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../fields/mask_pool.h"
+#include "../lib/shake_prng.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+#ifndef CROSSCOMPILE
+#include <unistd.h>
+#endif
+
+#define ITERATIONS 1000
+#define IDLE_US 1000 /*!< Idle time before each timed operation, left to the producer of the mask pool */
+
+static uint32_t enc_samples[ITERATIONS];
+static uint32_t dec_samples[ITERATIONS];
+
+
+static void idle(void) {
+#ifndef CROSSCOMPILE
+    usleep(IDLE_US);
+#endif
+}
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    unsigned char pk[PUBLIC_KEY_BYTES];
+    unsigned char sk[SECRET_KEY_BYTES];
+    unsigned char ct[CIPHERTEXT_BYTES];
+    unsigned char key1[SHARED_SECRET_BYTES];
+    unsigned char key2[SHARED_SECRET_BYTES];
+    size_t hits, misses;
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    uint32_t start, end;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    // masks generated inline, then taken from the pool when the build has one
+    for (int pool = 0; pool <= 1; pool++) {
+        if (pool && !mask_pool_start()) {
+            break;
+        }
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            crypto_kem_keypair(pk, sk);
+
+            idle();
+            start = rdtsc();
+            crypto_kem_enc(ct, key1, pk);
+            end = rdtsc();
+            enc_samples[i] = end - start;
+
+            idle();
+            start = rdtsc();
+            crypto_kem_dec(key2, ct, sk);
+            end = rdtsc();
+            dec_samples[i] = end - start;
+
+            errors += memcmp(key1, key2, SHARED_SECRET_BYTES) != 0;
+        }
+        mask_pool_stats(&hits, &misses);
+        mask_pool_stop();
+
+#ifdef DEBUG
+        printf("\r\n%s \r\n", pool ? "Mask pool" : "Inline masks");
+        printf("\r\nEncapsulation p50, p99 \r\n%u, %u\r\n", samples_percentile(enc_samples, ITERATIONS, 50),
+               samples_percentile(enc_samples, ITERATIONS, 99));
+        printf("\r\nDecapsulation p50, p99 \r\n%u, %u\r\n", samples_percentile(dec_samples, ITERATIONS, 50),
+               samples_percentile(dec_samples, ITERATIONS, 99));
+        if (pool) {
+            printf("\r\nMasks from the pool, generated inline \r\n%zu, %zu\r\n", hits, misses);
+        }
+#endif
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
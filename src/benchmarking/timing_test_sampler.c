@@ -0,0 +1,136 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../lib/shake_prng.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+#define ITERATIONS 1000
+
+static uint32_t ref_samples[ITERATIONS];
+static uint32_t new_samples[ITERATIONS];
+
+
+/**
+ * @brief The fixed-weight sampler one candidate at a time, with a modulo and a quadratic duplicate check, that
+ * vect_set_random_fixed_weight_by_coordinates must match unless the build has the constant-time one
+ */
+static void sample_reference(seedexpander_state *ctx, uint32_t *v, uint16_t weight) {
+    size_t random_bytes_size = 3 * weight;
+    uint8_t rand_bytes[3 * PARAM_OMEGA_R] = {0};
+    uint8_t inc;
+    size_t i, j;
+
+    i = 0;
+    j = random_bytes_size;
+    while (i < weight) {
+        do {
+            if (j == random_bytes_size) {
+                seedexpander(ctx, rand_bytes, random_bytes_size);
+                j = 0;
+            }
+
+            v[i]  = ((uint32_t) rand_bytes[j++]) << 16;
+            v[i] |= ((uint32_t) rand_bytes[j++]) << 8;
+            v[i] |= rand_bytes[j++];
+
+        } while (v[i] >= UTILS_REJECTION_THRESHOLD);
+
+        v[i] = v[i] % PARAM_N;
+
+        inc = 1;
+        for (size_t k = 0; k < i; k++) {
+            if (v[k] == v[i]) {
+                inc = 0;
+            }
+        }
+        i += inc;
+    }
+}
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const uint16_t weights[] = {PARAM_OMEGA, PARAM_OMEGA_R};
+
+    uint8_t seed[SEED_BYTES];
+    uint8_t ref_next[8], new_next[8];
+    uint32_t ref[PARAM_OMEGA_R], v[PARAM_OMEGA_R];
+    seedexpander_state ref_seedexpander, new_seedexpander;
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+    shake_prng_init(entropy_input, entropy_input, 128, 64);
+
+    uint32_t start, end;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (size_t w = 0; w < sizeof(weights) / sizeof(weights[0]); w++) {
+        for (int i = 0; i < ITERATIONS; i++) {
+            shake_prng(seed, SEED_BYTES);
+            seedexpander_init(&ref_seedexpander, seed, SEED_BYTES);
+            seedexpander_init(&new_seedexpander, seed, SEED_BYTES);
+
+            start = rdtsc();
+            sample_reference(&ref_seedexpander, ref, weights[w]);
+            end = rdtsc();
+            ref_samples[i] = end - start;
+
+            start = rdtsc();
+            vect_set_random_fixed_weight_by_coordinates(&new_seedexpander, v, weights[w]);
+            end = rdtsc();
+            new_samples[i] = end - start;
+
+#ifdef VECT_SAMPLER_CT
+            // distinct positions below PARAM_N, and 4.weight bytes drawn from the seedexpander whatever they are
+            for (size_t k = 0; k < weights[w]; k++) {
+                errors += v[k] >= PARAM_N;
+                for (size_t l = 0; l < k; l++) {
+                    errors += v[l] == v[k];
+                }
+            }
+            seedexpander_init(&ref_seedexpander, seed, SEED_BYTES);
+            seedexpander(&ref_seedexpander, (uint8_t *) ref, 4 * weights[w]);
+            seedexpander(&ref_seedexpander, ref_next, 8);
+            seedexpander(&new_seedexpander, new_next, 8);
+            errors += memcmp(ref_next, new_next, 8) != 0;
+#else
+            // same positions in the same order, and the seedexpanders left at the same point of the stream
+            seedexpander(&ref_seedexpander, ref_next, 8);
+            seedexpander(&new_seedexpander, new_next, 8);
+            errors += memcmp(ref, v, weights[w] * sizeof(uint32_t)) != 0;
+            errors += memcmp(ref_next, new_next, 8) != 0;
+#endif
+        }
+
+#ifdef DEBUG
+        printf("\r\nWeight \r\n%u\r\n", weights[w]);
+        printf("\r\nReference mean, p50, p99 \r\n%u, %u, %u\r\n", samples_mean(ref_samples, ITERATIONS),
+               samples_percentile(ref_samples, ITERATIONS, 50), samples_percentile(ref_samples, ITERATIONS, 99));
+        printf("\r\nvect_set_random_fixed_weight_by_coordinates mean, p50, p99 \r\n%u, %u, %u\r\n",
+               samples_mean(new_samples, ITERATIONS), samples_percentile(new_samples, ITERATIONS, 50),
+               samples_percentile(new_samples, ITERATIONS, 99));
+#endif
+    }
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
@@ -0,0 +1,92 @@
+#include "../common/api.h"
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../fields/gf2x.h"
+#include "board_config.h"
+#include <stdint.h>
+#include <string.h>
+#include "timing_stats.h"
+
+#define THREADS_MAX 8
+
+
+
+int main() {
+#ifdef CROSSCOMPILE
+    setup();
+    timer_init();
+#endif
+    const int ITERATIONS = 100;
+
+    uint8_t seed[SEED_BYTES];
+    uint32_t a1[PARAM_OMEGA_R] = {0};
+    uint64_t a2[VEC_N_SIZE_64] = {0};
+    uint64_t ref[VEC_N_SIZE_64] = {0};
+    uint64_t red[VEC_N_SIZE_64] = {0};
+    shares_t mulres, single;
+    seedexpander_state seedexpander;
+    int errors = 0;
+
+    // "Generate" entropy for the prng
+    uint8_t entropy_input[128];
+    for (int i=0; i<128; i++)
+        entropy_input[i] = i;
+
+    // timers declaration
+    uint32_t start, end;
+    welford_t safe_mul_timer;
+
+#ifdef CROSSCOMPILE
+    ledOn();
+#endif
+    for (unsigned threads = 1; threads <= THREADS_MAX; threads++) {
+        // skip the counts the build does not support
+        if (gf2x_set_threads(threads) != threads) {
+            continue;
+        }
+        welford_init(&safe_mul_timer);
+
+        // the same prng stream for every thread count, so that the shares can be compared
+        shake_prng_init(entropy_input, entropy_input, 128, 64);
+        for (int i = 0; i < ITERATIONS; i++) {
+            shake_prng(seed, SEED_BYTES);
+            seedexpander_init(&seedexpander, seed, SEED_BYTES);
+            vect_set_random(&seedexpander, a2);
+            vect_set_random_fixed_weight_by_coordinates(&seedexpander, a1, PARAM_OMEGA_R);
+
+            start = rdtsc();
+            safe_mul(&mulres, a1, a2, PARAM_OMEGA_R);
+            end = rdtsc();
+            welford_update(&safe_mul_timer, ((long double) (end - start)));
+
+            // the shares must add up to the product, and the last ones must be those of the single-threaded run
+            vect_mul(ref, a1, a2, PARAM_OMEGA_R);
+            if (threads == 1 && i == ITERATIONS - 1) {
+                single = mulres;
+            }
+            shares_reduce(red, &mulres);
+            errors += memcmp(red, ref, VEC_N_SIZE_BYTES) != 0;
+        }
+        if (threads > 1) {
+            errors += memcmp(&single, &mulres, shares_masks() * sizeof(mulres.s[0])) != 0;
+        }
+
+#ifdef DEBUG
+        printf("\r\nThreads \r\n%u\r\n", threads);
+        printf("\r\nsafe_mul \r\n");
+        welford_print(safe_mul_timer);
+#endif
+    }
+    gf2x_set_threads(1);
+
+#ifdef DEBUG
+    printf("\r\nMismatches \r\n%d\r\n", errors);
+#endif
+
+#ifdef CROSSCOMPILE
+    ledOff();
+    printf("\r\nDONE\r\n");
+#endif
+
+    return errors;
+}
@@ -38,6 +38,13 @@ int crypto_kem_keypair(unsigned char* pk, unsigned char* sk);
 int crypto_kem_enc(unsigned char* ct, unsigned char* ss, const unsigned char* pk);
 int crypto_kem_dec(unsigned char* ss, const unsigned char* ct, const unsigned char* sk);
 
+// The same with the random bytes and masks of a context of lib/hqc_rng.h, one per thread, instead of the default one
+struct hqc_rng;
+
+int crypto_kem_keypair_rng(unsigned char* pk, unsigned char* sk, struct hqc_rng* rng);
+int crypto_kem_enc_rng(unsigned char* ct, unsigned char* ss, const unsigned char* pk, struct hqc_rng* rng);
+int crypto_kem_dec_rng(unsigned char* ss, const unsigned char* ct, const unsigned char* sk, struct hqc_rng* rng);
+
 #ifdef CONST
 int crypto_kem_enc_const(unsigned char* ct, unsigned char* ss, const unsigned char* pk);
 #endif
@@ -37,7 +37,7 @@ void hqc_secret_key_to_string(uint8_t *sk, const uint8_t *sk_seed, const uint8_t
  *
  * @param[out] x uint64_t representation of vector x
  * @param[out] y uint32_t representation of vector y
- * @param[out] pk String containing the public key
+ * @param[out] pk String containing the public key, not copied if NULL
  * @param[in] sk String containing the secret key
  */
 void hqc_secret_key_from_string(uint64_t *x, uint32_t *y, uint8_t *pk, const uint8_t *sk) {
@@ -47,7 +47,9 @@ void hqc_secret_key_from_string(uint64_t *x, uint32_t *y, uint8_t *pk, const uin
 
     vect_set_random_fixed_weight(&sk_seedexpander, x, PARAM_OMEGA);
     vect_set_random_fixed_weight_by_coordinates(&sk_seedexpander, y, PARAM_OMEGA);
-    memcpy(pk, sk + SEED_BYTES, PUBLIC_KEY_BYTES);
+    if (pk != NULL) {
+        memcpy(pk, sk + SEED_BYTES, PUBLIC_KEY_BYTES);
+    }
 }
 
 
@@ -113,11 +115,13 @@ void hqc_ciphertext_to_string(uint8_t *ct, const uint64_t *u, const uint64_t *v,
  *
  * @param[out] u uint8_t representation of vector u
  * @param[out] v uint8_t representation of vector v
- * @param[out] d String containing the hash d
+ * @param[out] d String containing the hash d, not copied if NULL
  * @param[in] ct String containing the ciphertext
  */
 void hqc_ciphertext_from_string(uint64_t *u, uint64_t *v, uint8_t *d, const uint8_t *ct) {
     memcpy(u, ct, VEC_N_SIZE_BYTES);
     memcpy(v, ct + VEC_N_SIZE_BYTES, VEC_N1N2_SIZE_BYTES);
-    memcpy(d, ct + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES, SHAKE256_512_BYTES);
+    if (d != NULL) {
+        memcpy(d, ct + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES, SHAKE256_512_BYTES);
+    }
 }
@@ -10,6 +10,147 @@
 #include "../lib/shake_prng.h"
 #include "parameters.h"
 #include "vector.h"
+#include "vector_simd.h"
+
+
+#ifdef VECTOR_X86_SIMD
+static int vect_simd_resolved = 0; // 0 before the first call, 2 while the kernels are picked, 1 after
+#endif
+static size_t (*vect_candidates_simd)(uint32_t *, const uint8_t *, size_t) = NULL;
+static void (*vect_ct_duplicates_simd)(uint32_t *, size_t) = NULL;
+
+
+/**
+ * @brief Picks, on the first call, the widest kernels of vector_simd.c the CPU supports
+ *
+ * The first thread to get here picks them, the others wait for it, so that the threads of the mask pool and of the
+ * callers can sample side by side.
+ */
+static void vect_resolve_simd(void) {
+#ifdef VECTOR_X86_SIMD
+    int unresolved = 0;
+
+    if (__atomic_load_n(&vect_simd_resolved, __ATOMIC_ACQUIRE) == 1) {
+        return;
+    }
+    if (!__atomic_compare_exchange_n(&vect_simd_resolved, &unresolved, 2, 0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&vect_simd_resolved, __ATOMIC_ACQUIRE) != 1) {
+        }
+        return;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        vect_candidates_simd = vect_candidates_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        vect_candidates_simd = vect_candidates_avx2;
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        vect_ct_duplicates_simd = vect_ct_duplicates_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        vect_ct_duplicates_simd = vect_ct_duplicates_avx2;
+    }
+    __atomic_store_n(&vect_simd_resolved, 1, __ATOMIC_RELEASE);
+#endif
+}
+
+
+#ifdef VECT_SAMPLER_CT
+/**
+ * @brief Replaces every position equal to a later one by its index, without branches on the positions
+ *
+ * Position i being in [i, PARAM_N), the positions are then distinct: i is below every later position.
+ *
+ * @param[in,out] v Pointer to the positions
+ * @param[in] weight Number of positions
+ */
+static void vect_ct_duplicates(uint32_t *v, uint16_t weight) {
+    vect_resolve_simd();
+    if (vect_ct_duplicates_simd != NULL) {
+        vect_ct_duplicates_simd(v, weight);
+        return;
+    }
+
+    for (size_t i = weight - 1; i-- > 0;) {
+        uint32_t found = 0;
+
+        for (size_t j = i + 1; j < weight; j++) {
+            const uint32_t diff = v[j] ^ v[i];
+
+            found |= 1 ^ ((diff | (0 - diff)) >> 31);
+        }
+        const uint32_t mask = 0 - found;
+        v[i] = (mask & (uint32_t) i) ^ (~mask & v[i]);
+    }
+}
+
+
+
+/**
+ * @brief Generates a vector of a given Hamming weight, in a time that does not depend on the positions
+ *
+ * This function generates a random binary vector of a Hamming weight equal to the parameter <b>weight</b>, stored by
+ * position, with the sampler of the later versions of the HQC specification:
+ *  1. It draws 4.<b>weight</b> bytes from the seedexpander, read as <b>weight</b> little-endian 32-bit words
+ *     \f$ x_i \f$, whatever the positions.
+ *  2. Position \f$ i \f$ is \f$ i + \lfloor x_i (\mathrm{PARAM\_N} - i) / 2^{32} \rfloor \f$, in
+ *     \f$ [i, \mathrm{PARAM\_N}[ \f$, with a multiplication instead of a rejection loop.
+ *  3. From the last but one to the first, a position equal to one of the later positions is replaced by its index,
+ *     which no later position can be equal to; the comparisons and the selection have no branch.
+ *
+ * The positions differ from the ones of the rejection sampler, so are the KATs. Only the positions are computed in
+ * constant time: vect_set_random_fixed_weight sets their bits at addresses that depend on them, as it does with the
+ * rejection sampler.
+ *
+ * @param[in] v Pointer to an array
+ * @param[in] weight Integer that is the Hamming weight
+ * @param[in] ctx Pointer to the context of the seed expander
+ */
+void vect_set_random_fixed_weight_by_coordinates(seedexpander_state *ctx, uint32_t *v, uint16_t weight) {
+    const uint8_t *rand_bytes = (const uint8_t *) v;
+
+    // the bytes are drawn straight into v, each position overwriting the word it is computed from
+    seedexpander(ctx, (uint8_t *) v, 4 * weight);
+    for (size_t i = 0; i < weight; i++) {
+        const uint32_t x = rand_bytes[4 * i] | ((uint32_t) rand_bytes[4 * i + 1]) << 8 |
+                           ((uint32_t) rand_bytes[4 * i + 2]) << 16 | ((uint32_t) rand_bytes[4 * i + 3]) << 24;
+
+        v[i] = (uint32_t) i + (uint32_t) (((uint64_t) x * (PARAM_N - i)) >> 32);
+    }
+    vect_ct_duplicates(v, weight);
+}
+
+#else
+
+/**
+ * @brief Decodes, filters and reduces the candidates of the fixed-weight sampler
+ *
+ * The blocks of VECT_CANDIDATES_BLOCK candidates go to the widest kernel of vector_simd.c the CPU supports, the
+ * remaining ones to the scalar loop, which reduces with the same Barrett reduction.
+ *
+ * @param[out] out Pointer to the accepted positions, in the order of the stream, n words
+ * @param[in] in Pointer to the candidates, 3 bytes each
+ * @param[in] n Number of candidates
+ * @returns the number of accepted positions
+ */
+static size_t vect_candidates(uint32_t *out, const uint8_t *in, size_t n) {
+    size_t i = 0, k = 0;
+
+    vect_resolve_simd();
+    if (vect_candidates_simd != NULL) {
+        k = vect_candidates_simd(out, in, n);
+        i = n / VECT_CANDIDATES_BLOCK * VECT_CANDIDATES_BLOCK;
+    }
+
+    for (; i < n; i++) {
+        const uint32_t x = ((uint32_t) in[3 * i]) << 16 | ((uint32_t) in[3 * i + 1]) << 8 | in[3 * i + 2];
+        const uint32_t r = x - (uint32_t) (((uint64_t) x * VECT_BARRETT_FACTOR) >> 32) * PARAM_N;
+
+        out[k] = r >= PARAM_N ? r - PARAM_N : r;
+        k += x < UTILS_REJECTION_THRESHOLD;
+    }
+    return k;
+}
+
 
 
 /**
@@ -24,6 +165,10 @@
  *  4. It return \f$ r = x \mod 70853\f$
  *
  * The parameter \f$ t \f$ is precomputed and it's denoted by UTILS_REJECTION_THRESHOLD (see the file parameters.h).
+ * The candidates are drawn by blocks of <b>weight</b>, decoded, filtered and reduced with a Barrett reduction a whole
+ * block at a time, with the kernels of vector_simd.c where the CPU has them; a bitmap of the positions already drawn
+ * drops the duplicates, so that the positions, and the bytes drawn from the seedexpander, are the ones of the
+ * one-candidate-at-a-time algorithm.
  *
  * @param[in] v Pointer to an array
  * @param[in] weight Integer that is the Hamming weight
@@ -32,35 +177,25 @@
 void vect_set_random_fixed_weight_by_coordinates(seedexpander_state *ctx, uint32_t *v, uint16_t weight) {
     size_t random_bytes_size = 3 * weight;
     uint8_t rand_bytes[3 * PARAM_OMEGA_R] = {0}; // weight is expected to be <= PARAM_OMEGA_R
-    uint8_t inc;
-    size_t i, j;
+    uint32_t candidates[PARAM_OMEGA_R];
+    uint64_t seen[VEC_N_SIZE_64] = {0};
+    size_t i = 0;
 
-    i = 0;
-    j = random_bytes_size;
     while (i < weight) {
-        do {
-            if (j == random_bytes_size) {
-                seedexpander(ctx, rand_bytes, random_bytes_size);
-                j = 0;
-            }
-
-            v[i]  = ((uint32_t) rand_bytes[j++]) << 16;
-            v[i] |= ((uint32_t) rand_bytes[j++]) << 8;
-            v[i] |= rand_bytes[j++];
+        seedexpander(ctx, rand_bytes, random_bytes_size);
+        const size_t n = vect_candidates(candidates, rand_bytes, weight);
 
-        } while (v[i] >= UTILS_REJECTION_THRESHOLD);
+        // a duplicate is overwritten by the next candidate, as the first occurrence is already in v
+        for (size_t c = 0; c < n && i < weight; c++) {
+            const uint64_t bit = ((uint64_t) 1) << (candidates[c] % 64);
 
-        v[i] = v[i] % PARAM_N;
-
-        inc = 1;
-        for (size_t k = 0; k < i; k++) {
-            if (v[k] == v[i]) {
-                inc = 0;
-            }
+            v[i] = candidates[c];
+            i += (seen[candidates[c] / 64] & bit) == 0;
+            seen[candidates[c] / 64] |= bit;
         }
-        i += inc;
     }
 }
+#endif
 
 
 
@@ -98,17 +233,14 @@ void vect_set_random_fixed_weight(seedexpander_state *ctx, uint64_t *v, uint16_t
  * @brief Generates a random vector of dimension <b>PARAM_N</b>
  *
  * This function generates a random binary vector of dimension <b>PARAM_N</b>. It generates a random
- * array of bytes using the seedexpander function, and drop the extra bits using a mask.
+ * array of bytes using the seedexpander function, straight into the words of the vector, and drop the extra bits
+ * using a mask.
  *
  * @param[in] v Pointer to an array
  * @param[in] ctx Pointer to the context of the seed expander
  */
 void vect_set_random(seedexpander_state *ctx, uint64_t *v) {
-    uint8_t rand_bytes[VEC_N_SIZE_BYTES] = {0};
-
-    seedexpander(ctx, rand_bytes, VEC_N_SIZE_BYTES);
-
-    memcpy(v, rand_bytes, VEC_N_SIZE_BYTES);
+    seedexpander(ctx, (uint8_t *) v, VEC_N_SIZE_BYTES);
     v[VEC_N_SIZE_64 - 1] &= BITMASK(PARAM_N, 64);
 }
 
@@ -117,14 +249,15 @@ void vect_set_random(seedexpander_state *ctx, uint64_t *v) {
 /**
  * @brief Generates a random vector
  *
- * This function generates a random binary vector. It uses the prng function.
+ * This function generates a random binary vector. It uses the prng of a context.
  *
+ * @param[in,out] rng Pointer to the context of the prng
  * @param[in] v Pointer to an array
  */
-void vect_set_random_from_prng(uint64_t *v) {
+void vect_set_random_from_prng(hqc_rng *rng, uint64_t *v) {
     uint8_t rand_bytes [VEC_K_SIZE_BYTES] = {0};
 
-    shake_prng(rand_bytes, VEC_K_SIZE_BYTES);
+    hqc_rng_bytes(rng, rand_bytes, VEC_K_SIZE_BYTES);
     memcpy(v, rand_bytes, VEC_K_SIZE_BYTES);
 }
 
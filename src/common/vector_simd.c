@@ -0,0 +1,217 @@
+/**
+ * @file vector_simd.c
+ * @brief AVX2 and AVX-512 kernels for the candidates of the fixed-weight sampler
+ *
+ * Each 128-bit lane receives the 12 bytes of four candidates with a permutation of 32-bit words, then a byte shuffle
+ * reverses the three bytes of every candidate into a 32-bit lane. The reduction modulo PARAM_N is a Barrett
+ * reduction: the quotient estimated with the 64-bit products by VECT_BARRETT_FACTOR is at most one too small, which
+ * a single conditional subtraction corrects. AVX-512 packs the accepted candidates with a compressed store; AVX2,
+ * which has none, stores a block of 8 as is when none of them is rejected, the rare case, and packs it in scalar
+ * code otherwise.
+ * The duplicate correction of the constant-time sampler works on blocks of 8 or 16 positions from the last one: a
+ * block is first compared with every later position, already final, broadcast to all the lanes. Within the block,
+ * the compares of every lane with the later lanes and with their indices are all made up front, and the lanes to
+ * replace are resolved from the last one on bit masks, so that the vector compares do not wait on each other. The
+ * loops only depend on the weight and the lanes are selected with blends.
+ * They are compiled with per-function target attributes, so that vector.c can pick them at runtime depending on the
+ * features of the CPU.
+ */
+
+#include <stdint.h>
+
+#include "vector_simd.h"
+
+#ifdef VECTOR_X86_SIMD
+#include <immintrin.h>
+
+/**
+ * Destination of the bytes of the four candidates of a 128-bit lane, the fourth byte of every 32-bit lane cleared
+ */
+#define CANDIDATES_SHUFFLE 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1
+
+
+/**
+ * @brief Reduces 32-bit lanes below 2^24 modulo PARAM_N (256-bit lanes)
+ */
+__attribute__((target("avx2")))
+static inline __m256i barrett_avx2(__m256i x) {
+    const __m256i factor = _mm256_set1_epi32((int) VECT_BARRETT_FACTOR);
+    const __m256i n = _mm256_set1_epi32(PARAM_N);
+    const __m256i q_even = _mm256_srli_epi64(_mm256_mul_epu32(x, factor), 32);
+    const __m256i q_odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), factor);
+    const __m256i r = _mm256_sub_epi32(x, _mm256_mullo_epi32(_mm256_blend_epi32(q_even, q_odd, 0xaa), n));
+
+    return _mm256_min_epu32(r, _mm256_sub_epi32(r, n));
+}
+
+
+/**
+ * @brief Reduces 32-bit lanes below 2^24 modulo PARAM_N (512-bit lanes)
+ */
+__attribute__((target("avx512f")))
+static inline __m512i barrett_avx512(__m512i x) {
+    const __m512i factor = _mm512_set1_epi32((int) VECT_BARRETT_FACTOR);
+    const __m512i n = _mm512_set1_epi32(PARAM_N);
+    const __m512i q_even = _mm512_srli_epi64(_mm512_mul_epu32(x, factor), 32);
+    const __m512i q_odd = _mm512_mul_epu32(_mm512_srli_epi64(x, 32), factor);
+    const __m512i r = _mm512_sub_epi32(x, _mm512_mullo_epi32(_mm512_mask_blend_epi32(0xaaaa, q_even, q_odd), n));
+
+    return _mm512_min_epu32(r, _mm512_sub_epi32(r, n));
+}
+
+
+/**
+ * @brief Decodes, filters and reduces the candidates of the fixed-weight sampler, 8 at a time (256-bit lanes)
+ *
+ * @param[out] out Pointer to the accepted positions, n words
+ * @param[in] in Pointer to the candidates, 3 bytes each
+ * @param[in] n Number of candidates
+ * @returns the number of accepted positions
+ */
+__attribute__((target("avx2")))
+size_t vect_candidates_avx2(uint32_t *out, const uint8_t *in, size_t n) {
+    const __m256i spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i load = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+    const __m256i shuffle = _mm256_setr_epi8(CANDIDATES_SHUFFLE, CANDIDATES_SHUFFLE);
+    const __m256i threshold = _mm256_set1_epi32(UTILS_REJECTION_THRESHOLD);
+    size_t k = 0;
+
+    for (size_t i = 0; i + 8 <= n / VECT_CANDIDATES_BLOCK * VECT_CANDIDATES_BLOCK; i += 8) {
+        __m256i x = _mm256_maskload_epi32((const int *) (in + 3 * i), load);
+
+        x = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(x, spread), shuffle);
+        const __m256i r = barrett_avx2(x);
+        const int keep = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(threshold, x)));
+
+        if (keep == 0xff) {
+            _mm256_storeu_si256((__m256i *) (out + k), r);
+            k += 8;
+        } else {
+            uint32_t lanes[8];
+
+            _mm256_storeu_si256((__m256i *) lanes, r);
+            for (size_t c = 0; c < 8; c++) {
+                out[k] = lanes[c];
+                k += (keep >> c) & 1;
+            }
+        }
+    }
+    return k;
+}
+
+
+/**
+ * @brief Decodes, filters and reduces the candidates of the fixed-weight sampler, 16 at a time (512-bit lanes)
+ *
+ * @param[out] out Pointer to the accepted positions, n words
+ * @param[in] in Pointer to the candidates, 3 bytes each
+ * @param[in] n Number of candidates
+ * @returns the number of accepted positions
+ */
+__attribute__((target("avx512f,avx512bw")))
+size_t vect_candidates_avx512(uint32_t *out, const uint8_t *in, size_t n) {
+    const __m512i spread = _mm512_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0, 6, 7, 8, 0, 9, 10, 11, 0);
+    const __m512i shuffle = _mm512_broadcast_i32x4(_mm_setr_epi8(CANDIDATES_SHUFFLE));
+    const __m512i threshold = _mm512_set1_epi32(UTILS_REJECTION_THRESHOLD);
+    size_t k = 0;
+
+    for (size_t i = 0; i + VECT_CANDIDATES_BLOCK <= n; i += VECT_CANDIDATES_BLOCK) {
+        __m512i x = _mm512_maskz_loadu_epi32(0x0fff, in + 3 * i);
+
+        x = _mm512_shuffle_epi8(_mm512_permutexvar_epi32(spread, x), shuffle);
+        const __mmask16 keep = _mm512_cmplt_epu32_mask(x, threshold);
+
+        _mm512_mask_compressstoreu_epi32(out + k, keep, barrett_avx512(x));
+        k += (size_t) __builtin_popcount(keep);
+    }
+    return k;
+}
+
+
+/**
+ * @brief Replaces every position equal to a later one by its index, from the last but one to the first, by blocks
+ * of 8 positions (256-bit lanes)
+ *
+ * @param[in,out] v Pointer to the positions, position i in [i, PARAM_N)
+ * @param[in] weight Number of positions
+ */
+__attribute__((target("avx2")))
+void vect_ct_duplicates_avx2(uint32_t *v, size_t weight) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (size_t end = weight, start; end > 0; end = start) {
+        start = end >= 8 ? end - 8 : 0;
+        const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32((int) (end - start)), lane);
+        const __m256i index = _mm256_add_epi32(_mm256_set1_epi32((int) start), lane);
+        __m256i x = _mm256_maskload_epi32((const int *) (v + start), valid);
+        __m256i found = _mm256_setzero_si256();
+
+        // the later blocks are final
+        for (size_t j = end; j < weight; j++) {
+            found = _mm256_or_si256(found, _mm256_cmpeq_epi32(x, _mm256_set1_epi32((int) v[j])));
+        }
+        // then the block itself, from its last lane: lane l is replaced if a later lane kept a position equal to
+        // x[l] or was replaced by an index equal to x[l]
+        const uint32_t inter = (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(found));
+        uint32_t same[8], taken[8], replaced = 0;
+        for (size_t l = 0; l < end - start; l++) {
+            const __m256i at = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32((int) l));
+            const uint32_t later = ((1u << (end - start)) - 1) & ~((2u << l) - 1);
+
+            same[l] = later & (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(at, x)));
+            taken[l] = later & (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(at, index)));
+        }
+        for (size_t l = end - start; l-- > 0;) {
+            const uint32_t hit = ((inter >> l) & 1) | (uint32_t) (((same[l] & ~replaced) | (taken[l] & replaced)) != 0);
+
+            replaced |= hit << l;
+        }
+        const __m256i bit = _mm256_sllv_epi32(_mm256_set1_epi32(1), lane);
+        x = _mm256_blendv_epi8(x, index, _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int) replaced), bit), bit));
+        _mm256_maskstore_epi32((int *) (v + start), valid, x);
+    }
+}
+
+
+/**
+ * @brief Replaces every position equal to a later one by its index, from the last but one to the first, by blocks
+ * of 16 positions (512-bit lanes)
+ *
+ * @param[in,out] v Pointer to the positions, position i in [i, PARAM_N)
+ * @param[in] weight Number of positions
+ */
+__attribute__((target("avx512f")))
+void vect_ct_duplicates_avx512(uint32_t *v, size_t weight) {
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    for (size_t end = weight, start; end > 0; end = start) {
+        start = end >= 16 ? end - 16 : 0;
+        const __mmask16 valid = (__mmask16) ((1u << (end - start)) - 1);
+        const __m512i index = _mm512_add_epi32(_mm512_set1_epi32((int) start), lane);
+        __m512i x = _mm512_maskz_loadu_epi32(valid, v + start);
+        __mmask16 found = 0;
+
+        // the later blocks are final
+        for (size_t j = end; j < weight; j++) {
+            found |= _mm512_cmpeq_epu32_mask(x, _mm512_set1_epi32((int) v[j]));
+        }
+        // then the block itself, from its last lane: lane l is replaced if a later lane kept a position equal to
+        // x[l] or was replaced by an index equal to x[l]
+        __mmask16 same[16], taken[16], replaced = 0;
+        for (size_t l = 0; l < end - start; l++) {
+            const __m512i at = _mm512_permutexvar_epi32(_mm512_set1_epi32((int) l), x);
+            const __mmask16 later = (__mmask16) (valid & ~((2u << l) - 1));
+
+            same[l] = _mm512_mask_cmpeq_epu32_mask(later, at, x);
+            taken[l] = _mm512_mask_cmpeq_epu32_mask(later, at, index);
+        }
+        for (size_t l = end - start; l-- > 0;) {
+            const uint32_t hit = ((found >> l) & 1) | (uint32_t) (((same[l] & ~replaced) | (taken[l] & replaced)) != 0);
+
+            replaced |= (__mmask16) (hit << l);
+        }
+        x = _mm512_mask_blend_epi32(replaced, x, index);
+        _mm512_mask_storeu_epi32(v + start, valid, x);
+    }
+}
+#endif
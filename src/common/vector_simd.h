@@ -0,0 +1,37 @@
+#ifndef VECTOR_SIMD_H
+#define VECTOR_SIMD_H
+
+/**
+ * @file vector_simd.h
+ * @brief Header file for vector_simd.c
+ *
+ * The kernels decode the 24-bit big-endian candidates of the fixed-weight sampler of vector.c by blocks of
+ * VECT_CANDIDATES_BLOCK, drop the ones not below UTILS_REJECTION_THRESHOLD, reduce the others modulo PARAM_N and
+ * pack them at the start of the output, in the order of the stream. They process <b>n</b> rounded down to a whole
+ * number of blocks and return the number of accepted candidates; the caller decodes the remaining ones with the
+ * scalar code of vector.c.
+ * The duplicate correction of the constant-time sampler compares every position with all the later ones with masked
+ * loads and compares, and handles the whole support.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parameters.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define VECTOR_X86_SIMD
+#endif
+
+#define VECT_CANDIDATES_BLOCK 16 /*!< Candidates decoded by a block of the kernels */
+#define VECT_BARRETT_FACTOR ((uint32_t) ((((uint64_t) 1) << 32) / PARAM_N)) /*!< floor(2^32 / PARAM_N) */
+
+#ifdef VECTOR_X86_SIMD
+size_t vect_candidates_avx2(uint32_t *out, const uint8_t *in, size_t n);
+size_t vect_candidates_avx512(uint32_t *out, const uint8_t *in, size_t n);
+
+void vect_ct_duplicates_avx2(uint32_t *v, size_t weight);
+void vect_ct_duplicates_avx512(uint32_t *v, size_t weight);
+#endif
+
+#endif
@@ -9,12 +9,132 @@
 #include "../common/parameters.h"
 #include "../common/vector.h"
 #include "gf2x.h"
+#include "gf2x_dense.h"
+#include "gf2x_simd.h"
+#include "mask_pool.h"
 
-#define TABLE 16
-#define WORD 64
+#if defined(GF2X_THREADS) && GF2X_THREADS > 1 && MASKS != 1
+    #include <pthread.h>
+    #define GF2X_POOL
+#endif
+
+/**
+ * Accesses to the selection of the kernels, the algorithm and the tile width, which the threads of the callers and
+ * of the pool read while another one may set them
+ */
+#ifdef __GNUC__
+    #define GF2X_LOAD(v) __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+    #define GF2X_STORE(v, x) __atomic_store_n(&(v), (x), __ATOMIC_RELEASE)
+    #define GF2X_CAS(v, expected, x) __atomic_compare_exchange_n(&(v), &(expected), (x), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+    #define GF2X_LOAD(v) (v)
+    #define GF2X_STORE(v, x) ((v) = (x))
+    #define GF2X_CAS(v, expected, x) ((v) == (expected) ? ((v) = (x), 1) : ((expected) = (v), 0))
+#endif
+
+/**
+ * Algorithm picked by GF2X_MUL_AUTO. With the low weight of the sparse operands of HQC the table-based
+ * convolution was faster than the carry-less Karatsuba multiplication at every security level on the hosts we
+ * measured with TIMING-MUL, including VPCLMULQDQ ones; change it here to move the crossover.
+ */
+#if SECURITY_LEVEL == 128
+    #define GF2X_MUL_AUTO_CHOICE GF2X_MUL_SPARSE
+#elif SECURITY_LEVEL == 192
+    #define GF2X_MUL_AUTO_CHOICE GF2X_MUL_SPARSE
+#else
+    #define GF2X_MUL_AUTO_CHOICE GF2X_MUL_SPARSE
+#endif
+
+/**
+ * Width in 64-bit words of the column tiles of the convolution (0 disables the tiling). A tile of the shift table
+ * takes TABLE.(width + 1) words, so that with the default width of HQC-256 the tile and the double-length result
+ * stay in a 32 KB L1 data cache, whereas the full table would not fit in it.
+ */
+#ifndef GF2X_TILE_DEFAULT
+    #if SECURITY_LEVEL == 256
+        #define GF2X_TILE_DEFAULT 128
+    #else
+        #define GF2X_TILE_DEFAULT 0
+    #endif
+#endif
+#define GF2X_TILE_MAX 512
+
+/**
+ * Words of the doubled operand of the barrel-shifter multiplication, the operand plus its copy shifted by n bits:
+ * BARREL_SPAN is the first power of two not smaller than VEC_N_SIZE_64, and the padding keeps the first stage of
+ * the barrel shifter, which reads BARREL_SPAN / 2 words ahead, in bounds.
+ */
+#define BARREL_SPAN (VEC_N_SIZE_64 <= 512 ? 512 : 1024)
+#define BARREL_WORDS (VEC_N_SIZE_64 + BARREL_SPAN)
+
+#ifdef GF2X_LOW_STACK
+    // the streaming multiplication, the only one of the low-stack builds, needs no table
+    #define PLAN_TABLE_WORDS 1
+    #define PLAN_BARREL_WORDS 1
+#else
+    #define PLAN_TABLE_WORDS (TABLE * (VEC_N_SIZE_64 + MASKS_MAX))
+    #define PLAN_BARREL_WORDS (MASKS_MAX * BARREL_WORDS)
+#endif
+
+/**
+ * Kernels of one instruction set, published together by gf2x_set_isa so that a multiplication never mixes two sets
+ */
+typedef struct {
+    gf2x_isa_t isa;
+    const dense_base_t *dense_base;
+    void (*table_build)(uint64_t *, const uint64_t *, uint16_t);
+    void (*table_accumulate)(uint64_t *, const uint32_t *, const uint64_t *, uint16_t, uint16_t);
+    void (*span_xor)(uint8_t *, const uint8_t *, size_t);
+    void (*barrel_accumulate)(uint64_t *, const uint64_t *, uint32_t, uint64_t *, size_t, size_t, uint64_t);
+} gf2x_kernels_t;
+
+/**
+ * Multiplication plan of safe_mul: the shift tables of the slices of the dense operand, one per share, built once
+ * and shared by every product that involves the same slice. With d = shares_masks(), slice j starts at word
+ * j.(VEC_N_SIZE_64/d), the last one takes the remaining words, and its table starts at word
+ * TABLE.(j.(VEC_N_SIZE_64/d) + j).
+ * With the barrel-shifter multiplication the same storage holds the doubled slices, BARREL_WORDS words each; the
+ * streaming multiplication reads the slices of a2 directly. The plan also holds the algorithm and the kernels, so
+ * that a concurrent gf2x_set_mul or gf2x_set_isa applies from the next multiplication on.
+ */
+typedef struct {
+    const uint64_t *a2;
+    gf2x_mul_t mul; /*!< Algorithm of the whole multiplication, read once */
+    const gf2x_kernels_t *kernels; /*!< Kernels of the whole multiplication, read once */
+    uint64_t table[PLAN_TABLE_WORDS > PLAN_BARREL_WORDS ? PLAN_TABLE_WORDS : PLAN_BARREL_WORDS];
+} mul_plan_t;
+
+static const dense_base_t dense_base_portable = {base_mul_portable, 8};
+#ifdef GF2X_X86_SIMD
+static const dense_base_t dense_base_pclmul = {base_mul_pclmul, 16};
+static const dense_base_t dense_base_vpclmul = {base_mul_vpclmul, 32};
+#endif
 
 static void reduce(uint64_t *o, const uint64_t *a);
-static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size);
+static void table_build_scalar(uint64_t *table, const uint64_t *a2, uint16_t size);
+static void table_accumulate_scalar(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size);
+static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, const gf2x_kernels_t *kernels);
+static void tiled_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, uint16_t width, const gf2x_kernels_t *kernels);
+static void convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, gf2x_mul_t mul, const gf2x_kernels_t *kernels);
+static void span_xor_scalar(uint8_t *dst, const uint8_t *src, size_t units);
+static void table_accumulate_cyclic(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size, uint16_t offset, const gf2x_kernels_t *kernels);
+static void stream_accumulate(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, uint16_t offset);
+static void barrel_accumulate_scalar(uint64_t *o, const uint64_t *x, uint32_t t, uint64_t *buf, size_t words, size_t span, uint64_t last);
+static void barrel_expand(uint64_t *x, const uint64_t *a2, uint16_t size);
+static void barrel_mult(uint64_t *o, const uint32_t *a1, const uint64_t *x, uint16_t weight, uint16_t offset, const gf2x_kernels_t *kernels);
+static void mul_plan_init(mul_plan_t *plan, const uint64_t *a2);
+static void mul_plan_apply(uint64_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight, size_t slice);
+static inline void mask_add(uint64_t *si, uint64_t *sj, const uint64_t *s);
+#ifdef GF2X_POOL
+static unsigned pool_resize(unsigned threads);
+static void safe_mul_parallel(shares_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight);
+#endif
+
+static gf2x_kernels_t gf2x_kernel_sets[GF2X_ISA_AVX512 + 1]; /*!< Kernels given for each requested instruction set */
+static int gf2x_resolved = 0; /*!< 0, 2 while a thread fills gf2x_kernel_sets, 1 once it is filled */
+static const gf2x_kernels_t *gf2x_kernels = NULL; /*!< Selected kernels, NULL until the first use or gf2x_set_isa */
+static gf2x_mul_t gf2x_mul = GF2X_MUL_DEFAULT;
+static uint16_t gf2x_tile = GF2X_TILE_DEFAULT;
 
 
 /**
@@ -40,22 +160,191 @@ static void reduce(uint64_t *o, const uint64_t *a) {
 
 
 /**
- * @brief computes product of the polynomial a1(x) with the sparse polynomial a2; the dense polynomial
- * has always length VEC_N_SIZE_64/2
+ * @brief Fills, on the first call, the kernels given for each requested instruction set: the widest ones the CPU
+ * supports up to it
  *
- *  o(x) = a1(x)a2(x)
+ * The first thread to get here fills them, the others wait for it, as in vect_resolve_simd.
+ */
+static void gf2x_resolve(void) {
+    gf2x_kernels_t set = {GF2X_ISA_SCALAR, &dense_base_portable, table_build_scalar, table_accumulate_scalar,
+                          span_xor_scalar, barrel_accumulate_scalar};
+    int unresolved = 0;
+
+    if (GF2X_LOAD(gf2x_resolved) == 1) {
+        return;
+    }
+    if (!GF2X_CAS(gf2x_resolved, unresolved, 2)) {
+        while (GF2X_LOAD(gf2x_resolved) != 1) {
+        }
+        return;
+    }
+
+    gf2x_kernel_sets[GF2X_ISA_SCALAR] = set;
+#ifdef GF2X_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        set.isa = GF2X_ISA_AVX2;
+        set.table_build = table_build_avx2;
+        set.table_accumulate = table_accumulate_avx2;
+        set.span_xor = span_xor_avx2;
+        set.barrel_accumulate = barrel_accumulate_avx2;
+        if (__builtin_cpu_supports("pclmul")) {
+            set.dense_base = &dense_base_pclmul;
+        }
+    }
+    gf2x_kernel_sets[GF2X_ISA_AVX2] = set;
+    if (__builtin_cpu_supports("avx512f")) {
+        set.isa = GF2X_ISA_AVX512;
+        set.table_build = table_build_avx512;
+        set.table_accumulate = table_accumulate_avx512;
+        set.span_xor = __builtin_cpu_supports("avx512bw") ? span_xor_avx512 : span_xor_avx2;
+        set.barrel_accumulate = barrel_accumulate_avx512;
+        if (__builtin_cpu_supports("vpclmulqdq")) {
+            set.dense_base = &dense_base_vpclmul;
+        } else if (__builtin_cpu_supports("pclmul")) {
+            set.dense_base = &dense_base_pclmul;
+        }
+    }
+#else
+    gf2x_kernel_sets[GF2X_ISA_AVX2] = set;
+#endif
+    gf2x_kernel_sets[GF2X_ISA_AVX512] = set;
+    gf2x_kernel_sets[GF2X_ISA_AUTO] = set;
+    GF2X_STORE(gf2x_resolved, 1);
+}
+
+
+/**
+ * @brief Kernels of the next multiplication, the ones of GF2X_ISA_AUTO unless gf2x_set_isa picked others
+ */
+static const gf2x_kernels_t *gf2x_current(void) {
+    const gf2x_kernels_t *kernels = GF2X_LOAD(gf2x_kernels);
+
+    if (kernels == NULL) {
+        gf2x_resolve();
+        // a gf2x_set_isa of another thread in the meantime wins
+        GF2X_CAS(gf2x_kernels, kernels, &gf2x_kernel_sets[GF2X_ISA_AUTO]);
+        kernels = GF2X_LOAD(gf2x_kernels);
+    }
+    return kernels;
+}
+
+
+/**
+ * @brief Selects the kernels used by the sparse-by-dense multiplication
  *
- * @param[out] o Pointer to the result
- * @param[in] a1 Pointer to the sparse polynomial a2 (list of degrees of the monomials which appear in a2)
- * @param[in] a2 Pointer to the polynomial a1(x)
- * @param[in] weight Hamming wifht of the sparse polynomial a2
+ * With GF2X_ISA_AUTO the widest instruction set supported by the CPU is used; when the requested instruction
+ * set is not available, the function falls back to the widest narrower one. The kernels are published at once:
+ * the multiplications running meanwhile finish with the ones they started with.
+ *
+ * @param[in] isa The requested instruction set
+ * @returns the instruction set actually selected
  */
-static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, const uint16_t weight, const uint16_t size){
-    uint64_t carry;
-    uint64_t tmp;
-    uint64_t table[TABLE * (size + 1)];
+gf2x_isa_t gf2x_set_isa(gf2x_isa_t isa) {
+    const gf2x_kernels_t *kernels;
+
+    gf2x_resolve();
+    kernels = &gf2x_kernel_sets[isa];
+    GF2X_STORE(gf2x_kernels, kernels);
+    return kernels->isa;
+}
+
+
+/**
+ * @brief Algorithm given by a request with the kernels of an instruction set
+ */
+static gf2x_mul_t gf2x_mul_resolve(gf2x_mul_t mul, const gf2x_kernels_t *kernels) {
+#ifdef GF2X_LOW_STACK
+    (void) mul;
+    (void) kernels;
+    return GF2X_MUL_STREAM;
+#else
+    if (mul == GF2X_MUL_AUTO) {
+        mul = (GF2X_MUL_AUTO_CHOICE == GF2X_MUL_DENSE && kernels->dense_base != &dense_base_portable) ? GF2X_MUL_DENSE : GF2X_MUL_SPARSE;
+    }
+    return mul;
+#endif
+}
+
+
+/**
+ * @brief Selects the algorithm used by vect_mul and safe_mul
+ *
+ * With GF2X_MUL_AUTO the algorithm given by GF2X_MUL_AUTO_CHOICE for the current security level is used; the
+ * dense multiplication is only picked when the selected instruction set has a carry-less multiplication. The
+ * low-stack builds (GF2X_LOW_STACK) only have the streaming multiplication.
+ *
+ * @param[in] mul The requested algorithm
+ * @returns the algorithm actually selected
+ */
+gf2x_mul_t gf2x_set_mul(gf2x_mul_t mul) {
+    mul = gf2x_mul_resolve(mul, gf2x_current());
+    GF2X_STORE(gf2x_mul, mul);
+    return mul;
+}
+
+
+/**
+ * @brief Algorithm of the next multiplication, GF2X_MUL_DEFAULT resolved on the first use unless gf2x_set_mul
+ * picked another one
+ *
+ * @param[in] kernels Kernels of the multiplication
+ */
+static gf2x_mul_t gf2x_current_mul(const gf2x_kernels_t *kernels) {
+    gf2x_mul_t mul = GF2X_LOAD(gf2x_mul);
+
+    if (mul == GF2X_MUL_AUTO) {
+        // a gf2x_set_mul of another thread in the meantime wins
+        GF2X_CAS(gf2x_mul, mul, gf2x_mul_resolve(GF2X_MUL_AUTO, kernels));
+        mul = GF2X_LOAD(gf2x_mul);
+    }
+    return mul;
+}
+
+
+/**
+ * @brief Sets the width of the column tiles of the sparse convolution
+ *
+ * @param[in] width Width in 64-bit words of the tiles, 0 to disable the tiling; capped to GF2X_TILE_MAX
+ * @returns the width actually selected
+ */
+uint16_t gf2x_set_tile(uint16_t width) {
+    width = width > GF2X_TILE_MAX ? GF2X_TILE_MAX : width;
+    GF2X_STORE(gf2x_tile, width);
+
+    return width;
+}
+
+
+/**
+ * @brief Sets the number of threads of safe_mul, the calling one included
+ *
+ * The workers are started here and stay idle between the multiplications; 1 stops them. Without GF2X_THREADS,
+ * or with a single share, safe_mul always runs on the calling thread.
+ *
+ * @param[in] threads Requested number of threads, capped to GF2X_THREADS
+ * @returns the number of threads actually used
+ */
+unsigned gf2x_set_threads(unsigned threads) {
+#ifdef GF2X_POOL
+    return pool_resize(threads == 0 ? 1 : (threads > GF2X_THREADS ? GF2X_THREADS : threads));
+#else
+    (void) threads;
+    return 1;
+#endif
+}
 
 
+/**
+ * @brief Builds the table of the TABLE shifted copies of a2; row i contains a2(x).x^i and is size + 1 words long
+ *
+ * @param[out] table Pointer to the table, TABLE * (size + 1) words
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] size Number of 64-bit words of a2
+ */
+static void table_build_scalar(uint64_t *table, const uint64_t *a2, uint16_t size) {
+    uint64_t carry;
+
     memcpy(table, a2, size*sizeof(uint64_t));
     table[size] = 0x0UL;
 
@@ -68,11 +357,26 @@ static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_
         }
         table[i*(size+1)+size] = carry;
     }
+}
+
+
+/**
+ * @brief XORs into o the table row selected by each coordinate of the sparse polynomial a1, at the 16-bit
+ * offset given by the same coordinate
+ *
+ * @param[out] o Pointer to the result
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] table Pointer to the table of the shifted copies of the dense polynomial
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ */
+static void table_accumulate_scalar(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size) {
+    uint64_t tmp;
 
     for (size_t i = 0; i < weight; i++) {
         uint16_t *res_16 = (uint16_t *) o+(a1[i] >> 4);
 
-        for (size_t j = 0; j < size + 1; j++) {
+        for (size_t j = 0; j < (size_t) size + 1; j++) {
             tmp = (uint64_t) res_16[0] | ((uint64_t) (res_16[1])) << 16 |
                            (uint64_t) (res_16[2]) << 32 | ((uint64_t) (res_16[3])) << 48;
             tmp ^= table[((a1[i] & 0xf) * (size + 1))+j];
@@ -83,6 +387,412 @@ static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_
 }
 
 
+/**
+ * @brief XORs <b>units</b> unaligned 16-bit units of src into dst
+ *
+ * @param[out] dst Pointer to the destination
+ * @param[in] src Pointer to the source
+ * @param[in] units Number of 16-bit units
+ */
+static void span_xor_scalar(uint8_t *dst, const uint8_t *src, size_t units) {
+    size_t j;
+
+    for (j = 0; j + 4 <= units; j += 4) {
+        uint64_t a, b;
+        memcpy(&a, dst + 2 * j, 8);
+        memcpy(&b, src + 2 * j, 8);
+        a ^= b;
+        memcpy(dst + 2 * j, &a, 8);
+    }
+    for (; j < units; j++) {
+        uint16_t a, b;
+        memcpy(&a, dst + 2 * j, 2);
+        memcpy(&b, src + 2 * j, 2);
+        a ^= b;
+        memcpy(dst + 2 * j, &a, 2);
+    }
+}
+
+
+/**
+ * @brief XORs into o, modulo \f$ X^n - 1\f$, the table row selected by each coordinate of the sparse
+ * polynomial a1, shifted by 64.offset bits
+ *
+ * The product of a coordinate with the dense slice starts at bit pos = a1[i] + 64.offset (taken modulo n) and
+ * is split at X^n: the bits below it are XORed from row pos & 0xf at the 16-bit offset pos >> 4, the ones
+ * above it wrap around to bit 0, from the row that has the same alignment as pos - n. The result never needs
+ * to be reduced and o must be reduced on input.
+ *
+ * @param[out] o Pointer to the result, VEC_N_SIZE_64 words
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] table Pointer to the table of the shifted copies of the dense polynomial
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ * @param[in] offset Position in 64-bit words of the dense polynomial in the full vector
+ * @param[in] kernels Kernels of the multiplication
+ */
+static void table_accumulate_cyclic(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size, uint16_t offset, const gf2x_kernels_t *kernels) {
+    const size_t units = 4 * ((size_t) size + 1);
+    const size_t top = PARAM_N >> 4;
+    const uint32_t up = (PARAM_N + 0xf) & ~0xfU;
+    const uint16_t top_mask = (uint16_t) ((1U << (PARAM_N & 0xf)) - 1);
+    uint8_t *res = (uint8_t *) o;
+
+    for (size_t i = 0; i < weight; i++) {
+        uint32_t pos = a1[i] + 64 * (uint32_t) offset;
+        pos -= PARAM_N & -(uint32_t) (pos >= PARAM_N);
+
+        // bits from pos up to X^n
+        const size_t q = pos >> 4;
+        const uint8_t *row = (const uint8_t *) (table + (pos & 0xf) * (size + 1));
+        if (top - q < units) {
+            uint16_t a, b;
+
+            kernels->span_xor(res + 2 * q, row, top - q);
+            memcpy(&a, res + 2 * top, 2);
+            memcpy(&b, row + 2 * (top - q), 2);
+            a ^= b & top_mask;
+            memcpy(res + 2 * top, &a, 2);
+        } else {
+            kernels->span_xor(res + 2 * q, row, units);
+        }
+
+        // bits from X^n on, wrapped to bit 0
+        const uint32_t wrap = pos + up - PARAM_N;
+        const size_t skip = (up >> 4) - (wrap >> 4);
+        const uint8_t *row_wrap = (const uint8_t *) (table + (wrap & 0xf) * (size + 1));
+        if (skip < units) {
+            kernels->span_xor(res, row_wrap + 2 * skip, units - skip < top + 1 ? units - skip : top + 1);
+        }
+    }
+}
+
+
+/**
+ * @brief computes product of the polynomial a1(x) with the sparse polynomial a2; the dense polynomial
+ * has always length VEC_N_SIZE_64/2
+ *
+ *  o(x) = a1(x)a2(x)
+ *
+ * @param[out] o Pointer to the result
+ * @param[in] a1 Pointer to the sparse polynomial a2 (list of degrees of the monomials which appear in a2)
+ * @param[in] a2 Pointer to the polynomial a1(x)
+ * @param[in] weight Hamming wifht of the sparse polynomial a2
+ * @param[in] kernels Kernels of the multiplication
+ */
+static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, const uint16_t weight, const uint16_t size, const gf2x_kernels_t *kernels){
+    const uint16_t width = GF2X_LOAD(gf2x_tile);
+
+    if (width != 0 && width < size) {
+        tiled_convolution_mult(o, a1, a2, weight, size, width, kernels);
+        return;
+    }
+
+    uint64_t table[TABLE * (size + 1)];
+
+    kernels->table_build(table, a2, size);
+    kernels->table_accumulate(o, a1, table, weight, size);
+}
+
+
+/**
+ * @brief Cache-blocked version of fast_convolution_mult
+ *
+ * The dense polynomial is processed in tiles of <b>width</b> words: the table of the shifted copies of one tile is
+ * built and every coordinate of a1 is applied to it before moving to the next tile, so that only a tile of the
+ * table is live at any time. The table of a tile is the slice of the full table restricted to its columns, except
+ * for its last column, the carry out of the tile, which is added again by the first column of the next tile.
+ *
+ *  o(x) = o(x) + a1(x)a2(x)
+ *
+ * @param[out] o Pointer to the result
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ * @param[in] width Width in 64-bit words of the tiles
+ * @param[in] kernels Kernels of the multiplication
+ */
+static void tiled_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, uint16_t width, const gf2x_kernels_t *kernels) {
+    uint64_t tile[TABLE * (width + 1)];
+
+    for (uint16_t c = 0; c < size; c += width) {
+        const uint16_t len = (size - c) < width ? (size - c) : width;
+
+        kernels->table_build(tile, a2 + c, len);
+        kernels->table_accumulate(o + c, a1, tile, weight, len);
+    }
+}
+
+
+/**
+ * @brief Adds to o the product of the sparse polynomial a1 with the dense polynomial a2, with the dense or the
+ * table-based algorithm
+ *
+ *  o(x) = o(x) + a1(x)a2(x)
+ *
+ * @param[out] o Pointer to the result, at least VEC_N_SIZE_64 + size + 1 words
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ * @param[in] mul Algorithm of the multiplication
+ * @param[in] kernels Kernels of the multiplication
+ */
+static void convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, gf2x_mul_t mul, const gf2x_kernels_t *kernels) {
+    if (mul == GF2X_MUL_DENSE) {
+        uint64_t dense[VEC_N_SIZE_64];
+
+        dense_expand(dense, a1, weight);
+        dense_mul(o, dense, VEC_N_SIZE_64, a2, size, kernels->dense_base);
+    } else {
+        fast_convolution_mult(o, a1, a2, weight, size, kernels);
+    }
+}
+
+
+/**
+ * @brief Adds to o, modulo \f$ X^n - 1\f$, the product of the sparse polynomial a1 with a dense polynomial placed at
+ * the 64-bit word <b>offset</b>, shifting the dense polynomial on the fly
+ *
+ * Every coordinate XORs the shifted words of a2 straight into o: the bits that land below X^n from the word
+ * pos >> 6 on, the ones above it from bit 0, so that neither a shift table nor a double-length result is needed.
+ * o must be reduced on input.
+ *
+ * @param[out] o Pointer to the result, VEC_N_SIZE_64 words
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ * @param[in] offset Position in 64-bit words of the dense polynomial in the full vector
+ */
+static void stream_accumulate(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, uint16_t size, uint16_t offset) {
+    for (size_t i = 0; i < weight; i++) {
+        uint32_t pos = a1[i] + 64 * (uint32_t) offset;
+        pos -= PARAM_N & -(uint32_t) (pos >= PARAM_N);
+
+        // bits from pos up to X^n; the left shifts are split in two so that a shift of 0 does not shift by 64
+        const size_t q = pos >> 6;
+        const uint32_t r = pos & 0x3F;
+        const size_t direct = (VEC_N_SIZE_64 - q) < size ? (VEC_N_SIZE_64 - q) : size;
+
+        o[q] ^= a2[0] << r;
+        for (size_t k = 1; k < direct; k++) {
+            o[q + k] ^= (a2[k] << r) | ((a2[k - 1] >> 1) >> (WORD - 1 - r));
+        }
+        if (q + direct < VEC_N_SIZE_64) {
+            o[q + direct] ^= (a2[direct - 1] >> 1) >> (WORD - 1 - r);
+        }
+        o[VEC_N_SIZE_64 - 1] &= RED_MASK;
+
+        // bits from X^n on, wrapped to bit 0: word k gets the 64 bits of a2 from bit n - pos + 64k
+        const uint32_t b = PARAM_N - pos;
+        const size_t p = b >> 6;
+        const uint32_t t = b & 0x3F;
+
+        if (p < size) {
+            for (size_t k = 0; p + k + 1 < size; k++) {
+                o[k] ^= (a2[p + k] >> t) | ((a2[p + k + 1] << 1) << (WORD - 1 - t));
+            }
+            o[size - 1 - p] ^= a2[size - 1] >> t;
+        }
+    }
+}
+
+
+/**
+ * @brief Adds to o the n-bit window of x that starts at bit t, with a barrel shifter
+ *
+ * Each stage selects with a mask, without branches, between its input and its input shifted by a power of two
+ * words; the last pass shifts the result by t & 0x3F bits.
+ *
+ * @param[out] o Pointer to the result, <b>words</b> words
+ * @param[in] x Pointer to the doubled operand, <b>words</b> + <b>span</b> words
+ * @param[in] t Bit offset of the window, t >> 6 < span
+ * @param[out] buf Pointer to the scratch, 2 (<b>words</b> + <b>span</b> / 2) words
+ * @param[in] words Number of words of the result
+ * @param[in] span Power of two not smaller than <b>words</b>
+ * @param[in] last Mask of the valid bits of the last word of the result
+ */
+static void barrel_accumulate_scalar(uint64_t *o, const uint64_t *x, uint32_t t, uint64_t *buf, size_t words, size_t span, uint64_t last) {
+    const uint32_t r = t & 0x3F;
+    const uint64_t *cur = x;
+    uint64_t *out = buf;
+    uint64_t w;
+
+    for (size_t step = span / 2; step > 0; step >>= 1) {
+        const uint64_t mask = -(uint64_t) (((t >> 6) & step) != 0);
+
+        for (size_t i = 0; i < words + step; i++) {
+            out[i] = cur[i] ^ (mask & (cur[i] ^ cur[i + step]));
+        }
+        cur = out;
+        out = out == buf ? buf + words + span / 2 : buf;
+    }
+
+    for (size_t k = 0; k < words; k++) {
+        // the left shift is split in two so that r = 0 does not shift by 64
+        w = (cur[k] >> r) | ((cur[k + 1] << 1) << (WORD - 1 - r));
+        o[k] ^= k == words - 1 ? w & last : w;
+    }
+}
+
+
+/**
+ * @brief Builds the doubled operand of the barrel-shifter multiplication, x(x) = a2(x) + a2(x)x^n
+ *
+ * @param[out] x Pointer to the doubled operand, BARREL_WORDS words
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] size Number of 64-bit words of a2
+ */
+static void barrel_expand(uint64_t *x, const uint64_t *a2, uint16_t size) {
+    const size_t word = PARAM_N >> 6;
+    const uint32_t bit = PARAM_N & 0x3F;
+
+    memset(x, 0x00, BARREL_WORDS * sizeof(uint64_t));
+    memcpy(x, a2, size * sizeof(uint64_t));
+    for (size_t j = 0; j < size; j++) {
+        x[word + j] ^= a2[j] << bit;
+        x[word + j + 1] ^= (a2[j] >> 1) >> (WORD - 1 - bit);
+    }
+}
+
+
+/**
+ * @brief Adds to o, modulo \f$ X^n - 1\f$, the product of the sparse polynomial a1 with a dense polynomial placed at
+ * the 64-bit word <b>offset</b>, without secret-dependent memory accesses or branches
+ *
+ * The product with the monomial x^a is the rotation of the dense polynomial by a bits, that is the n-bit window
+ * of its doubled operand that starts at bit t = n - a, which barrel_accumulate extracts in constant time.
+ *
+ * @param[out] o Pointer to the result, VEC_N_SIZE_64 words
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] x Pointer to the doubled operand of the dense polynomial, built by barrel_expand
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] offset Position in 64-bit words of the dense polynomial in the full vector
+ * @param[in] kernels Kernels of the multiplication
+ */
+static void barrel_mult(uint64_t *o, const uint32_t *a1, const uint64_t *x, uint16_t weight, uint16_t offset, const gf2x_kernels_t *kernels) {
+    uint64_t buf[2 * (VEC_N_SIZE_64 + BARREL_SPAN / 2)] __attribute__((aligned(64)));
+
+    for (size_t i = 0; i < weight; i++) {
+        uint32_t a = a1[i] + 64 * (uint32_t) offset;
+        a -= PARAM_N & -(uint32_t) (a >= PARAM_N);
+
+        kernels->barrel_accumulate(o, x, PARAM_N - a, buf, VEC_N_SIZE_64, BARREL_SPAN, RED_MASK);
+    }
+}
+
+
+/**
+ * @brief Prepares the multiplication plan of the dense polynomial a2, building the shift table of each slice
+ *
+ * The algorithm and the kernels selected at this point are recorded for the whole multiplication. With the dense
+ * and streaming algorithms no table is needed and only a2 is recorded; with the barrel shifter the doubled operand
+ * of each slice is built instead.
+ *
+ * @param[out] plan Pointer to the plan
+ * @param[in] a2 Pointer to the dense polynomial
+ */
+static void mul_plan_init(mul_plan_t *plan, const uint64_t *a2) {
+    plan->a2 = a2;
+    plan->kernels = gf2x_current();
+    plan->mul = gf2x_current_mul(plan->kernels);
+    if (plan->mul == GF2X_MUL_DENSE || plan->mul == GF2X_MUL_STREAM) {
+        return;
+    }
+
+#ifndef GF2X_LOW_STACK
+    const size_t masks = shares_masks();
+
+    for (size_t j = 0; j < masks; j++) {
+        const size_t offset = j * (VEC_N_SIZE_64 / masks);
+        const uint16_t size = j < masks - 1 ? VEC_N_SIZE_64 / masks : VEC_N_SIZE_64 - offset;
+
+        if (plan->mul == GF2X_MUL_BARREL) {
+            barrel_expand(plan->table + j * BARREL_WORDS, a2 + offset, size);
+        } else {
+            plan->kernels->table_build(plan->table + TABLE * (offset + j), a2 + offset, size);
+        }
+    }
+#endif
+}
+
+
+/**
+ * @brief Adds to o, modulo \f$ X^n - 1\f$, the product of the sparse polynomial a1 with one slice of the dense
+ * polynomial of the plan, with the algorithm of the plan
+ *
+ *  o(x) = o(x) + a1(x)a2_slice(x)x^(64.offset) mod (X^n - 1)
+ *
+ * @param[out] o Pointer to the result, VEC_N_SIZE_64 words
+ * @param[in] plan Pointer to the plan of the dense polynomial
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of the monomials which appear in it)
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] slice Index of the slice of the dense polynomial, less than shares_masks()
+ */
+static void mul_plan_apply(uint64_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight, size_t slice) {
+    const size_t masks = shares_masks();
+    const size_t offset = slice * (VEC_N_SIZE_64 / masks);
+    const uint16_t size = slice < masks - 1 ? VEC_N_SIZE_64 / masks : VEC_N_SIZE_64 - offset;
+
+    if (plan->mul == GF2X_MUL_STREAM) {
+        stream_accumulate(o, a1, plan->a2 + offset, weight, size, offset);
+        return;
+    }
+
+#ifndef GF2X_LOW_STACK
+    if (plan->mul == GF2X_MUL_DENSE) {
+        // the Karatsuba tree works on the full product, which is reduced afterwards
+        uint64_t raw[(VEC_N_SIZE_64 << 1) + 1] = {0};
+        uint64_t tmp[VEC_N_SIZE_64];
+
+        convolution_mult(raw + offset, a1, plan->a2 + offset, weight, size, plan->mul, plan->kernels);
+        reduce(tmp, raw);
+        vect_add(o, o, tmp, VEC_N_SIZE_64);
+    } else if (plan->mul == GF2X_MUL_BARREL) {
+        barrel_mult(o, a1, plan->table + slice * BARREL_WORDS, weight, offset, plan->kernels);
+    } else {
+        table_accumulate_cyclic(o, a1, plan->table + TABLE * (offset + slice), weight, size, offset, plan->kernels);
+    }
+#endif
+}
+
+
+#if defined(GF2X_GENERATED) && !defined(GF2X_LOW_STACK)
+    // safe_mul with the table-based convolution, specialized for this configuration by scripts/multUnroll.py
+    #include "gf2x_kernels.h"
+#endif
+
+
+/**
+ * @brief vect_mul with the algorithm and the kernels of the caller
+ */
+static void vect_mul_with(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, gf2x_mul_t mul, const gf2x_kernels_t *kernels) {
+    if (mul == GF2X_MUL_STREAM) {
+        memset(o, 0x00, VEC_N_SIZE_64 * sizeof(uint64_t));
+        stream_accumulate(o, a1, a2, weight, VEC_N_SIZE_64, 0);
+        return;
+    }
+
+#ifndef GF2X_LOW_STACK
+    if (mul == GF2X_MUL_BARREL) {
+        uint64_t x[BARREL_WORDS] __attribute__((aligned(64)));
+
+        barrel_expand(x, a2, VEC_N_SIZE_64);
+        memset(o, 0x00, VEC_N_SIZE_64 * sizeof(uint64_t));
+        barrel_mult(o, a1, x, weight, 0, kernels);
+        return;
+    }
+
+    uint64_t tmp[(VEC_N_SIZE_64 << 1) + 1] = {0};
+
+    convolution_mult(tmp, a1, a2, weight, VEC_N_SIZE_64, mul, kernels);
+    reduce(o, tmp);
+#endif
+}
+
+
 /**
  * @brief Multiply two polynomials modulo \f$ X^n - 1\f$.
  *
@@ -96,105 +806,151 @@ static void fast_convolution_mult(uint64_t *o, const uint32_t *a1, const uint64_
  * @param[in] ctx Pointer to the randomness context
  */
 void vect_mul(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight) {
-    uint64_t tmp[(VEC_N_SIZE_64 << 1) + 1] = {0};
+    const gf2x_kernels_t *kernels = gf2x_current();
 
-    fast_convolution_mult(tmp, a1, a2, weight, VEC_N_SIZE_64);
-    reduce(o, tmp);
+    vect_mul_with(o, a1, a2, weight, gf2x_current_mul(kernels), kernels);
 }
 
 
 /**
- * @brief Sets the given vector null
+ * @brief Multiply <b>count</b> sparse polynomials with the same dense polynomial modulo \f$ X^n - 1\f$
+ *
+ * The shift table of a2 is built once, and every product is folded modulo \f$ X^n - 1\f$ directly into its
+ * result while the table is hot in the cache.
  *
- * @param vec the raw_temp vector to nullify
+ * @param[out] o Pointer to the <b>count</b> results, VEC_N_SIZE_64 words each
+ * @param[in] a1 Pointer to the <b>count</b> sparse polynomials, <b>weight</b> coordinates each
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] weight Integer that is the weight of the sparse polynomials
+ * @param[in] count Number of sparse polynomials
+ */
+void vect_mul_batch(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, size_t count) {
+    const gf2x_kernels_t *kernels = gf2x_current();
+    const gf2x_mul_t mul = gf2x_current_mul(kernels);
+
+    if (mul == GF2X_MUL_DENSE || mul == GF2X_MUL_STREAM) {
+        for (size_t k = 0; k < count; k++) {
+            vect_mul_with(o + k * VEC_N_SIZE_64, a1 + k * weight, a2, weight, mul, kernels);
+        }
+        return;
+    }
+
+#ifndef GF2X_LOW_STACK
+    if (mul == GF2X_MUL_BARREL) {
+        uint64_t x[BARREL_WORDS] __attribute__((aligned(64)));
+
+        barrel_expand(x, a2, VEC_N_SIZE_64);
+        for (size_t k = 0; k < count; k++) {
+            memset(o + k * VEC_N_SIZE_64, 0x00, VEC_N_SIZE_64 * sizeof(uint64_t));
+            barrel_mult(o + k * VEC_N_SIZE_64, a1 + k * weight, x, weight, 0, kernels);
+        }
+        return;
+    }
+
+    uint64_t table[TABLE * (VEC_N_SIZE_64 + 1)];
+
+    kernels->table_build(table, a2, VEC_N_SIZE_64);
+    for (size_t k = 0; k < count; k++) {
+        memset(o + k * VEC_N_SIZE_64, 0x00, VEC_N_SIZE_64 * sizeof(uint64_t));
+        table_accumulate_cyclic(o + k * VEC_N_SIZE_64, a1 + k * weight, table, weight, VEC_N_SIZE_64, 0, kernels);
+    }
+#endif
+}
+
+
+/**
+ * @brief Adds the mask s to the two shares of a cross term, in a single pass
+ *
+ * @param[out] si Pointer to the first share
+ * @param[out] sj Pointer to the second share
+ * @param[in] s Pointer to the mask
  */
 static inline
-void reset(uint64_t *vec) {
-    memset(vec, 0x00, ((VEC_N_SIZE_64<<1)+1)*8);
+void mask_add(uint64_t *si, uint64_t *sj, const uint64_t *s) {
+    for (size_t i = 0; i < VEC_N_SIZE_64; i++) {
+        si[i] ^= s[i];
+        sj[i] ^= s[i];
+    }
 }
 
 
+#if MASKS == 0
 /**
- * @brief Multiply two polynomials modulo \f$ X^n - 1\f$, with masking
+ * @brief Masked multiplication of the sparse polynomial a1 with the dense polynomial of a plan, with the number of
+ * shares chosen at run time
  *
- * This functions multiplies a sparse polynomial <b>a1</b> (of Hamming weight equal to <b>weight</b>)
- * and a dense polynomial <b>a2</b>; he multiplication is done modulo \f$ X^n - 1\f$. This function also
- * implements masking to avoid information leakage
+ * The loops run the products, the masks and the prng draws of the unrolled bodies of safe_mul_planned in the same
+ * order: share i gets the product of part i of a1 with slice i, then every cross term (i, j), i < j, adds a fresh
+ * mask to shares i and j and the products of part i with slice j and of part j with slice i to share j.
  *
  * @param[out] o Pointer to the result
+ * @param[in] plan Pointer to the plan of the dense polynomial
  * @param[in] a1 Pointer to the sparse polynomial
- * @param[in] a2 Pointer to the dense polynomial
  * @param[in] weight Integer that is the weight of the sparse polynomial
  */
-void safe_mul(shares_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight) {
+static void safe_mul_looped(shares_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight) {
+    const size_t masks = shares_masks();
+    const uint16_t part = weight / masks;
+    uint64_t s[VEC_N_SIZE_64] = {0};
+
+    shares_init(o);
+    for (size_t i = 0; i < masks; i++) {
+        mul_plan_apply(o->s[i], plan, a1 + i * part, i < masks - 1 ? part : weight - part * i, i);
+    }
+
+    for (size_t i = 0; i < masks; i++) {
+        for (size_t j = i + 1; j < masks; j++) {
+            shares_mask_cross_term(s, weight);
+            mask_add(o->s[i], o->s[j], s);
+            mul_plan_apply(o->s[j], plan, a1 + i * part, part, j);
+            mul_plan_apply(o->s[j], plan, a1 + j * part, j < masks - 1 ? part : weight - part * j, i);
+        }
+    }
+}
+#endif
+
+
+/**
+ * @brief Masked multiplication of the sparse polynomial a1 with the dense polynomial of a plan
+ *
+ * @param[out] o Pointer to the result
+ * @param[in] plan Pointer to the plan of the dense polynomial
+ * @param[in] a1 Pointer to the sparse polynomial
+ * @param[in] weight Integer that is the weight of the sparse polynomial
+ */
+static void safe_mul_planned(shares_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight) {
 #ifdef VERBOSE
     printf("\nsparse_in: ");
     for(int i=0;i<PARAM_OMEGA;i++) printf("%x ", a1[i]);
 #endif
-    uint64_t temp1[VEC_N_SIZE_64] = {0};
-    uint64_t temp2[VEC_N_SIZE_64] = {0};
-    uint64_t raw_temp[(VEC_N_SIZE_64 << 1) + 1];
-
+#if defined(GF2X_GENERATED) && !defined(GF2X_LOW_STACK)
+    if (plan->mul == GF2X_MUL_SPARSE && gen_safe_mul(o, plan, a1, weight)) {
+        return;
+    }
+#endif
+#if MASKS == 0
+    safe_mul_looped(o, plan, a1, weight);
+#else
     uint64_t s[VEC_N_SIZE_64] = {0};
-    uint64_t s1[VEC_N_SIZE_64] = {0};
-
-    seedexpander_state mask_seedexpander;
-    uint8_t seed[SEED_BYTES];
 
 #if MASKS == 1
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/1)),
-                          a1+(0*(weight/1)), a2+(0*(VEC_N_SIZE_64/1)),
-                          weight - (weight/1)*0, VEC_N_SIZE_64 - (VEC_N_SIZE_64/1)*0);
-    reduce(o->s0, raw_temp);
+    shares_init(o);
+    mul_plan_apply(o->s[0], plan, a1+(0*(weight/1)), weight - (weight/1)*0, 0);
 #elif MASKS == 2
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/2)),
-                          a1+(0*(weight/2)), a2+(0*(VEC_N_SIZE_64/2)),
-                          weight/2, VEC_N_SIZE_64/2);
-    reduce(o->s0, raw_temp);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/2)),
-                          a1+(1*(weight/2)), a2+(1*(VEC_N_SIZE_64/2)),
-                          weight - (weight/2)*1, VEC_N_SIZE_64 - (VEC_N_SIZE_64/2)*1);
-    reduce(o->s1, raw_temp);
+    shares_init(o);
+    mul_plan_apply(o->s[0], plan, a1+(0*(weight/2)), weight/2, 0);
+    mul_plan_apply(o->s[1], plan, a1+(1*(weight/2)), weight - (weight/2)*1, 1);
 #elif MASKS == 3
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/3)),
-                          a1+(0*(weight/3)), a2+(0*(VEC_N_SIZE_64/3)),
-                          weight/3, VEC_N_SIZE_64/3);
-    reduce(o->s0, raw_temp);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/3)),
-                          a1+(1*(weight/3)), a2+(1*(VEC_N_SIZE_64/3)),
-                          weight/3, VEC_N_SIZE_64/3);
-    reduce(o->s1, raw_temp);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/3)),
-                          a1+(2*(weight/3)), a2+(2*(VEC_N_SIZE_64/3)),
-                          weight - (weight/3)*2, VEC_N_SIZE_64 - (VEC_N_SIZE_64/3)*2);
-    reduce(o->s2, raw_temp);
+    shares_init(o);
+    mul_plan_apply(o->s[0], plan, a1+(0*(weight/3)), weight/3, 0);
+    mul_plan_apply(o->s[1], plan, a1+(1*(weight/3)), weight/3, 1);
+    mul_plan_apply(o->s[2], plan, a1+(2*(weight/3)), weight - (weight/3)*2, 2);
 #elif MASKS == 4
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/4)),
-                          a1+(0*(weight/4)), a2+(0*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(o->s0, raw_temp);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/4)),
-                          a1+(1*(weight/4)), a2+(1*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(o->s1, raw_temp);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/4)),
-                          a1+(2*(weight/4)), a2+(2*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(o->s2, raw_temp);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(3*(VEC_N_SIZE_64/4)),
-                          a1+(3*(weight/4)), a2+(3*(VEC_N_SIZE_64/4)),
-                          weight - (weight/4)*3, VEC_N_SIZE_64 - (VEC_N_SIZE_64/4)*3);
-    reduce(o->s3, raw_temp);
+    shares_init(o);
+    mul_plan_apply(o->s[0], plan, a1+(0*(weight/4)), weight/4, 0);
+    mul_plan_apply(o->s[1], plan, a1+(1*(weight/4)), weight/4, 1);
+    mul_plan_apply(o->s[2], plan, a1+(2*(weight/4)), weight/4, 2);
+    mul_plan_apply(o->s[3], plan, a1+(3*(weight/4)), weight - (weight/4)*3, 3);
 #endif
 
 // PART 2
@@ -202,184 +958,341 @@ void safe_mul(shares_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weig
 #if MASKS == 1
     // nothing, no masking applied
 #elif MASKS == 2
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/2)),
-                          a1+(0*(weight/2)), a2+(1*(VEC_N_SIZE_64/2)),
-                          weight/2, VEC_N_SIZE_64 - (VEC_N_SIZE_64/2)*1);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/2)),
-                          a1+(1*(weight/2)), a2+(0*(VEC_N_SIZE_64/2)),
-                          weight - (weight/2)*1, VEC_N_SIZE_64/2);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s0, o->s0, s, VEC_N_SIZE_64);
-    vect_add(o->s1, o->s1, s1, VEC_N_SIZE_64);
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[0], o->s[1], s);
+    mul_plan_apply(o->s[1], plan, a1+(0*(weight/2)), weight/2, 1);
+    mul_plan_apply(o->s[1], plan, a1+(1*(weight/2)), weight - (weight/2)*1, 0);
 #elif MASKS == 3
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/3)),
-                          a1+(0*(weight/3)), a2+(1*(VEC_N_SIZE_64/3)),
-                          weight/3, VEC_N_SIZE_64/3);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/3)),
-                          a1+(1*(weight/3)), a2+(0*(VEC_N_SIZE_64/3)),
-                          weight/3, VEC_N_SIZE_64/3);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s0, o->s0, s, VEC_N_SIZE_64);
-    vect_add(o->s1, o->s1, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/3)),
-                          a1+(0*(weight/3)), a2+(2*(VEC_N_SIZE_64/3)),
-                          weight/3, VEC_N_SIZE_64 - (VEC_N_SIZE_64/3)*2);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/3)),
-                          a1+(2*(weight/3)), a2+(0*(VEC_N_SIZE_64/3)),
-                          weight - (weight/3)*2, VEC_N_SIZE_64/3);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s0, o->s0, s, VEC_N_SIZE_64);
-    vect_add(o->s2, o->s2, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/3)),
-                          a1+(1*(weight/3)), a2+(2*(VEC_N_SIZE_64/3)),
-                          weight/3, VEC_N_SIZE_64 - (VEC_N_SIZE_64/3)*2);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/3)),
-                          a1+(2*(weight/3)), a2+(1*(VEC_N_SIZE_64/3)),
-                          weight - (weight/3)*2, VEC_N_SIZE_64/3);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s1, o->s1, s, VEC_N_SIZE_64);
-    vect_add(o->s2, o->s2, s1, VEC_N_SIZE_64);
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[0], o->s[1], s);
+    mul_plan_apply(o->s[1], plan, a1+(0*(weight/3)), weight/3, 1);
+    mul_plan_apply(o->s[1], plan, a1+(1*(weight/3)), weight/3, 0);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[0], o->s[2], s);
+    mul_plan_apply(o->s[2], plan, a1+(0*(weight/3)), weight/3, 2);
+    mul_plan_apply(o->s[2], plan, a1+(2*(weight/3)), weight - (weight/3)*2, 0);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[1], o->s[2], s);
+    mul_plan_apply(o->s[2], plan, a1+(1*(weight/3)), weight/3, 2);
+    mul_plan_apply(o->s[2], plan, a1+(2*(weight/3)), weight - (weight/3)*2, 1);
 #elif MASKS == 4
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/4)),
-                          a1+(0*(weight/4)), a2+(1*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/4)),
-                          a1+(1*(weight/4)), a2+(0*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s0, o->s0, s, VEC_N_SIZE_64);
-    vect_add(o->s1, o->s1, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/4)),
-                          a1+(0*(weight/4)), a2+(2*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/4)),
-                          a1+(2*(weight/4)), a2+(0*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s0, o->s0, s, VEC_N_SIZE_64);
-    vect_add(o->s2, o->s2, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(3*(VEC_N_SIZE_64/4)),
-                          a1+(0*(weight/4)), a2+(3*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64 - (VEC_N_SIZE_64/4)*3);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(0*(VEC_N_SIZE_64/4)),
-                          a1+(3*(weight/4)), a2+(0*(VEC_N_SIZE_64/4)),
-                          weight - (weight/4)*3, VEC_N_SIZE_64/4);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s0, o->s0, s, VEC_N_SIZE_64);
-    vect_add(o->s3, o->s3, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/4)),
-                          a1+(1*(weight/4)), a2+(2*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/4)),
-                          a1+(2*(weight/4)), a2+(1*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64/4);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s1, o->s1, s, VEC_N_SIZE_64);
-    vect_add(o->s2, o->s2, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(3*(VEC_N_SIZE_64/4)),
-                          a1+(1*(weight/4)), a2+(3*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64 - (VEC_N_SIZE_64/4)*3);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(1*(VEC_N_SIZE_64/4)),
-                          a1+(3*(weight/4)), a2+(1*(VEC_N_SIZE_64/4)),
-                          weight - (weight/4)*3, VEC_N_SIZE_64/4);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s1, o->s1, s, VEC_N_SIZE_64);
-    vect_add(o->s3, o->s3, s1, VEC_N_SIZE_64);
-
-    shake_prng(seed, SEED_BYTES);
-    seedexpander_init(&mask_seedexpander, seed, SEED_BYTES);
-    vect_set_random_fixed_weight(&mask_seedexpander, s, weight);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(3*(VEC_N_SIZE_64/4)),
-                          a1+(2*(weight/4)), a2+(3*(VEC_N_SIZE_64/4)),
-                          weight/4, VEC_N_SIZE_64 - (VEC_N_SIZE_64/4)*3);
-    reduce(temp1, raw_temp);
-    vect_add(temp1, temp1, s, VEC_N_SIZE_64);
-    memset(raw_temp, 0x00, (VEC_N_SIZE_64*2+1)*8);
-    fast_convolution_mult(raw_temp+(2*(VEC_N_SIZE_64/4)),
-                          a1+(3*(weight/4)), a2+(2*(VEC_N_SIZE_64/4)),
-                          weight - (weight/4)*3, VEC_N_SIZE_64/4);
-    reduce(temp2, raw_temp);
-    vect_add(s1, temp1, temp2, VEC_N_SIZE_64);
-    vect_add(o->s2, o->s2, s, VEC_N_SIZE_64);
-    vect_add(o->s3, o->s3, s1, VEC_N_SIZE_64);
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[0], o->s[1], s);
+    mul_plan_apply(o->s[1], plan, a1+(0*(weight/4)), weight/4, 1);
+    mul_plan_apply(o->s[1], plan, a1+(1*(weight/4)), weight/4, 0);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[0], o->s[2], s);
+    mul_plan_apply(o->s[2], plan, a1+(0*(weight/4)), weight/4, 2);
+    mul_plan_apply(o->s[2], plan, a1+(2*(weight/4)), weight/4, 0);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[0], o->s[3], s);
+    mul_plan_apply(o->s[3], plan, a1+(0*(weight/4)), weight/4, 3);
+    mul_plan_apply(o->s[3], plan, a1+(3*(weight/4)), weight - (weight/4)*3, 0);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[1], o->s[2], s);
+    mul_plan_apply(o->s[2], plan, a1+(1*(weight/4)), weight/4, 2);
+    mul_plan_apply(o->s[2], plan, a1+(2*(weight/4)), weight/4, 1);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[1], o->s[3], s);
+    mul_plan_apply(o->s[3], plan, a1+(1*(weight/4)), weight/4, 3);
+    mul_plan_apply(o->s[3], plan, a1+(3*(weight/4)), weight - (weight/4)*3, 1);
+
+    shares_mask_cross_term(s, weight);
+    mask_add(o->s[2], o->s[3], s);
+    mul_plan_apply(o->s[3], plan, a1+(2*(weight/4)), weight/4, 3);
+    mul_plan_apply(o->s[3], plan, a1+(3*(weight/4)), weight - (weight/4)*3, 2);
+#endif
+#endif
+}
+
+
+#ifdef GF2X_POOL
+#define PAIRS_MAX (MASKS_MAX * (MASKS_MAX - 1) / 2) /*!< Largest number of cross terms of safe_mul */
+
+/**
+ * Work of one safe_mul shared by the pool: with d shares, the diagonal products are tasks 0 to d - 1 and write
+ * their own share; the cross terms are the next d(d - 1)/2 tasks, in the order of the sequential code, and each one
+ * writes its two products in its own buffer, so that the calling thread can add them and the masks, drawn before
+ * the tasks start, to the shares in a fixed order.
+ */
+typedef struct {
+    uint64_t *share[MASKS_MAX];
+    const mul_plan_t *plan;
+    const uint32_t *a1;
+    uint16_t weight;
+    size_t masks;
+    uint64_t mask[PAIRS_MAX][VEC_N_SIZE_64];
+    uint64_t term[PAIRS_MAX][VEC_N_SIZE_64];
+} safe_mul_job_t;
+
+/**
+ * Per-thread state of the pool
+ */
+typedef struct {
+    pthread_t thread;
+} pool_worker_t;
+
+/**
+ * Persistent pool of safe_mul: worker[0] is the calling thread, worker[1] to worker[threads - 1] wait on start
+ * for a new generation of tasks and take them from next under the lock. The thread of a multiplication holds owner,
+ * so that the ones of other threads run sequentially meanwhile.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    pool_worker_t worker[GF2X_THREADS];
+    unsigned threads;
+    unsigned generation;
+    int stop;
+    size_t next;
+    size_t finished;
+    size_t count;
+    safe_mul_job_t *job;
+    pthread_mutex_t owner;
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, .threads = 1,
+          .owner = PTHREAD_MUTEX_INITIALIZER};
+
+static safe_mul_job_t pool_job;
+
+
+/**
+ * @brief Runs a task of safe_mul
+ *
+ * @param[in,out] job Pointer to the work of the multiplication
+ * @param[in] task Index of the task
+ */
+static void safe_mul_task(safe_mul_job_t *job, size_t task) {
+    const size_t masks = job->masks;
+    const uint16_t part = job->weight / masks;
+    size_t i = task;
+    size_t j;
+
+    if (task < masks) {
+        mul_plan_apply(job->share[i], job->plan, job->a1 + i * part, i == masks - 1 ? job->weight - part * i : part, i);
+        return;
+    }
+
+    // cross term (i, j) with i < j, numbered in lexicographic order
+    const size_t pair = task - masks;
+    size_t k = pair;
+    for (i = 0; k >= masks - 1 - i; i++) {
+        k -= masks - 1 - i;
+    }
+    j = i + 1 + k;
+
+    memset(job->term[pair], 0x00, VEC_N_SIZE_BYTES);
+    mul_plan_apply(job->term[pair], job->plan, job->a1 + i * part, part, j);
+    mul_plan_apply(job->term[pair], job->plan, job->a1 + j * part, j == masks - 1 ? job->weight - part * j : part, i);
+}
+
+
+/**
+ * @brief Takes and runs the tasks of the current generation until none is left; called with the lock held
+ *
+ * @param[in] worker Pointer to the state of the calling thread
+ */
+static void pool_drain(pool_worker_t *worker) {
+    (void) worker;
+    while (pool.next < pool.count) {
+        const size_t task = pool.next++;
+        safe_mul_job_t *job = pool.job;
+
+        pthread_mutex_unlock(&pool.lock);
+        safe_mul_task(job, task);
+        pthread_mutex_lock(&pool.lock);
+
+        if (++pool.finished == pool.count) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+}
+
+
+static void *pool_main(void *arg) {
+    pool_worker_t *worker = arg;
+    unsigned seen;
+
+    pthread_mutex_lock(&pool.lock);
+    seen = pool.generation;
+    for (;;) {
+        while (!pool.stop && pool.generation == seen) {
+            pthread_cond_wait(&pool.start, &pool.lock);
+        }
+        if (pool.stop) {
+            break;
+        }
+        seen = pool.generation;
+        pool_drain(worker);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Stops the workers of the pool and starts <b>threads</b> - 1 new ones
+ *
+ * @param[in] threads Number of threads, the calling one included, 1 <= threads <= GF2X_THREADS
+ * @returns the number of threads actually running, smaller than requested if a worker could not be created
+ */
+static unsigned pool_resize(unsigned threads) {
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    for (unsigned k = 1; k < pool.threads; k++) {
+        pthread_join(pool.worker[k].thread, NULL);
+    }
+
+    pool.stop = 0;
+    pool.threads = 1;
+    while (pool.threads < threads) {
+        if (pthread_create(&pool.worker[pool.threads].thread, NULL, pool_main, &pool.worker[pool.threads]) != 0) {
+            break;
+        }
+        pool.threads++;
+    }
+
+    return pool.threads;
+}
+
+
+/**
+ * @brief Claims the pool for the multiplications of the calling thread
+ *
+ * @returns 1 if the pool has workers and no other thread holds it, in which case it is released with pool_release,
+ * 0 otherwise
+ */
+static int pool_claim(void) {
+    return pool.threads > 1 && shares_masks() > 1 && pthread_mutex_trylock(&pool.owner) == 0;
+}
+
+
+/**
+ * @brief Releases the pool claimed by pool_claim
+ */
+static void pool_release(void) {
+    pthread_mutex_unlock(&pool.owner);
+}
+
+
+/**
+ * @brief Masked multiplication of the sparse polynomial a1 with the dense polynomial of a plan, on the pool
+ *
+ * The masks are drawn by the calling thread in the order of safe_mul_planned, before the tasks start, and added in
+ * that same order, so that the shares are identical to the ones of the sequential code for any number of threads.
+ *
+ * @param[out] o Pointer to the result
+ * @param[in] plan Pointer to the plan of the dense polynomial
+ * @param[in] a1 Pointer to the sparse polynomial
+ * @param[in] weight Integer that is the weight of the sparse polynomial
+ */
+static void safe_mul_parallel(shares_t *o, const mul_plan_t *plan, const uint32_t *a1, uint16_t weight) {
+    safe_mul_job_t *job = &pool_job;
+    const size_t masks = shares_masks();
+    const size_t pairs = masks * (masks - 1) / 2;
+    uint64_t s[VEC_N_SIZE_64] = {0};
+    size_t pair = 0;
+
+    shares_init(o);
+    for (size_t i = 0; i < masks; i++) {
+        job->share[i] = o->s[i];
+    }
+    job->plan = plan;
+    job->a1 = a1;
+    job->weight = weight;
+    job->masks = masks;
+    // job->mask[k] is the value of s at the k-th cross term of the sequential code
+    for (size_t k = 0; k < pairs; k++) {
+        shares_mask_cross_term(s, weight);
+        memcpy(job->mask[k], s, VEC_N_SIZE_BYTES);
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.job = job;
+    pool.next = 0;
+    pool.finished = 0;
+    pool.count = masks + pairs;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    pool_drain(&pool.worker[0]);
+    while (pool.finished < pool.count) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    for (size_t i = 0; i < masks; i++) {
+        for (size_t j = i + 1; j < masks; j++, pair++) {
+            for (size_t k = 0; k < VEC_N_SIZE_64; k++) {
+                job->share[i][k] ^= job->mask[pair][k];
+                job->share[j][k] ^= job->mask[pair][k] ^ job->term[pair][k];
+            }
+        }
+    }
+}
 #endif
+
+
+/**
+ * @brief Multiply two polynomials modulo \f$ X^n - 1\f$, with masking
+ *
+ * This functions multiplies a sparse polynomial <b>a1</b> (of Hamming weight equal to <b>weight</b>)
+ * and a dense polynomial <b>a2</b>; he multiplication is done modulo \f$ X^n - 1\f$. This function also
+ * implements masking to avoid information leakage
+ *
+ * @param[out] o Pointer to the result
+ * @param[in] a1 Pointer to the sparse polynomial
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] weight Integer that is the weight of the sparse polynomial
+ */
+void safe_mul(shares_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight) {
+    mul_plan_t plan;
+
+    mul_plan_init(&plan, a2);
+#ifdef GF2X_POOL
+    if (pool_claim()) {
+        safe_mul_parallel(o, &plan, a1, weight);
+        pool_release();
+        return;
+    }
+#endif
+    safe_mul_planned(o, &plan, a1, weight);
+}
+
+
+/**
+ * @brief Multiply <b>count</b> sparse polynomials with the same dense polynomial modulo \f$ X^n - 1\f$, with
+ * masking
+ *
+ * The shift tables of a2 are built once and shared by all the products; every product is masked as in safe_mul,
+ * with fresh masks.
+ *
+ * @param[out] o Pointer to the <b>count</b> results
+ * @param[in] a1 Pointer to the <b>count</b> sparse polynomials, <b>weight</b> coordinates each
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] weight Integer that is the weight of the sparse polynomials
+ * @param[in] count Number of sparse polynomials
+ */
+void safe_mul_batch(shares_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, size_t count) {
+    mul_plan_t plan;
+
+    mul_plan_init(&plan, a2);
+    for (size_t k = 0; k < count; k++) {
+#ifdef GF2X_POOL
+        if (pool_claim()) {
+            safe_mul_parallel(o + k, &plan, a1 + k * weight, weight);
+            pool_release();
+            continue;
+        }
+#endif
+        safe_mul_planned(o + k, &plan, a1 + k * weight, weight);
+    }
 }
@@ -6,14 +6,52 @@
  * @brief Header file for gf2x.c
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "../lib/mask_rng.h"
 #include "../lib/shake_prng.h"
 #include "shares.h"
 
+/**
+ * Instruction sets available for the kernels of the sparse-by-dense multiplication
+ */
+typedef enum {
+    GF2X_ISA_AUTO = 0,
+    GF2X_ISA_SCALAR,
+    GF2X_ISA_AVX2,
+    GF2X_ISA_AVX512
+} gf2x_isa_t;
+
+/**
+ * Algorithms available for the multiplications: the table-based sparse-by-dense convolution, the carry-less
+ * Karatsuba multiplication with the sparse operand expanded to dense, the rotation of the dense operand by
+ * every sparse coordinate with a barrel shifter, or the sparse-by-dense convolution with the shifts computed on
+ * the fly and no table; the dense and barrel ones do not access memory at secret-dependent addresses, the
+ * streaming one has the smallest stack
+ */
+typedef enum {
+    GF2X_MUL_AUTO = 0,
+    GF2X_MUL_SPARSE,
+    GF2X_MUL_DENSE,
+    GF2X_MUL_BARREL,
+    GF2X_MUL_STREAM
+} gf2x_mul_t;
+
+#ifndef GF2X_MUL_DEFAULT
+    #define GF2X_MUL_DEFAULT GF2X_MUL_AUTO
+#endif
+
+gf2x_isa_t gf2x_set_isa(gf2x_isa_t isa);
+gf2x_mul_t gf2x_set_mul(gf2x_mul_t mul);
+uint16_t gf2x_set_tile(uint16_t width);
+unsigned gf2x_set_threads(unsigned threads);
 
 void vect_mul(uint64_t *o, const uint32_t *v1, const uint64_t *v2, uint16_t weight);
 void safe_mul(shares_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight);
 
+void vect_mul_batch(uint64_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, size_t count);
+void safe_mul_batch(shares_t *o, const uint32_t *a1, const uint64_t *a2, uint16_t weight, size_t count);
+
 
 #endif
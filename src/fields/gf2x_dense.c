@@ -0,0 +1,163 @@
+/**
+ * @file gf2x_dense.c
+ * @brief Dense carry-less Karatsuba multiplication of binary polynomials
+ *
+ * The products are computed with a recursive Karatsuba tree whose leaves are schoolbook multiplications of at
+ * most KARATSUBA_THRESHOLD words. The leaves are provided by the caller: a portable constant-time version is
+ * defined here, the PCLMULQDQ/VPCLMULQDQ ones are in gf2x_simd.c. No memory access depends on the value of the
+ * operands.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../common/parameters.h"
+#include "gf2x_dense.h"
+
+
+/**
+ * @brief Carry-less product of two 64-bit words, in constant time
+ *
+ * @param[out] hi Pointer to the 64 most significant bits of the product
+ * @param[in] a First operand
+ * @param[in] b Second operand
+ * @returns the 64 least significant bits of the product
+ */
+static uint64_t clmul_portable(uint64_t *hi, uint64_t a, uint64_t b) {
+    uint64_t lo = a & -(b & 1);
+    uint64_t h = 0;
+
+    for (size_t i = 1; i < 64; i++) {
+        uint64_t mask = -((b >> i) & 1);
+        lo ^= (a << i) & mask;
+        h ^= (a >> (64 - i)) & mask;
+    }
+
+    *hi = h;
+    return lo;
+}
+
+
+/**
+ * @brief Schoolbook multiplication of two polynomials of n words, with the portable carry-less product
+ *
+ * @param[out] o Pointer to the result, 2n words
+ * @param[in] a Pointer to the first polynomial
+ * @param[in] b Pointer to the second polynomial
+ * @param[in] n Number of 64-bit words of the operands
+ */
+void base_mul_portable(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n) {
+    uint64_t hi;
+
+    memset(o, 0x00, 2 * n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            o[i + j] ^= clmul_portable(&hi, a[i], b[j]);
+            o[i + j + 1] ^= hi;
+        }
+    }
+}
+
+
+/**
+ * @brief Karatsuba multiplication of two polynomials of n words
+ *
+ * The operands are split in a low part of m = ceil(n/2) words and a high part of n - m words, and
+ * a.b = z0 + x^(64m).(z1 - z0 - z2) + x^(128m).z2 with z0 = a0.b0, z2 = a1.b1 and z1 = (a0 + a1).(b0 + b1).
+ *
+ * @param[out] o Pointer to the result, 2n words
+ * @param[in] a Pointer to the first polynomial
+ * @param[in] b Pointer to the second polynomial
+ * @param[in] n Number of 64-bit words of the operands
+ * @param[in] base Schoolbook multiplication used for the leaves of the tree
+ */
+static void karatsuba(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n, const dense_base_t *base) {
+    if (n <= base->threshold) {
+        base->mul(o, a, b, n);
+        return;
+    }
+
+    const size_t m = (n + 1) / 2;
+    const size_t h = n - m;
+    uint64_t sa[m];
+    uint64_t sb[m];
+    uint64_t z1[2 * m];
+
+    karatsuba(o, a, b, m, base);
+    karatsuba(o + 2 * m, a + m, b + m, h, base);
+
+    for (size_t i = 0; i < h; i++) {
+        sa[i] = a[i] ^ a[m + i];
+        sb[i] = b[i] ^ b[m + i];
+    }
+    for (size_t i = h; i < m; i++) {
+        sa[i] = a[i];
+        sb[i] = b[i];
+    }
+    karatsuba(z1, sa, sb, m, base);
+
+    for (size_t i = 0; i < 2 * m; i++) {
+        z1[i] ^= o[i];
+    }
+    for (size_t i = 0; i < 2 * h; i++) {
+        z1[i] ^= o[2 * m + i];
+    }
+    for (size_t i = 0; i < 2 * m; i++) {
+        o[m + i] ^= z1[i];
+    }
+}
+
+
+/**
+ * @brief Adds to o the product of two dense polynomials
+ *
+ *  o(x) = o(x) + a(x)b(x)
+ *
+ * The longer operand is cut in chunks as long as the shorter one, and every chunk goes through the Karatsuba tree.
+ *
+ * @param[out] o Pointer to the result, at least na + nb words
+ * @param[in] a Pointer to the first polynomial
+ * @param[in] na Number of 64-bit words of a
+ * @param[in] b Pointer to the second polynomial
+ * @param[in] nb Number of 64-bit words of b, nb <= na
+ * @param[in] base Schoolbook multiplication used for the leaves of the tree
+ */
+void dense_mul(uint64_t *o, const uint64_t *a, size_t na, const uint64_t *b, size_t nb, const dense_base_t *base) {
+    uint64_t chunk[nb];
+    uint64_t prod[2 * nb];
+
+    for (size_t i = 0; i < na; i += nb) {
+        const size_t len = (na - i) < nb ? (na - i) : nb;
+
+        memcpy(chunk, a + i, len * sizeof(uint64_t));
+        memset(chunk + len, 0x00, (nb - len) * sizeof(uint64_t));
+        karatsuba(prod, chunk, b, nb, base);
+
+        for (size_t j = 0; j < len + nb; j++) {
+            o[i + j] ^= prod[j];
+        }
+    }
+}
+
+
+/**
+ * @brief Expands a sparse polynomial, given by the list of its monomials, into a dense one
+ *
+ * Every word of the result is computed from every coordinate, so that no memory access depends on
+ * the coordinates.
+ *
+ * @param[out] o Pointer to the result, VEC_N_SIZE_64 words
+ * @param[in] a Pointer to the sparse polynomial
+ * @param[in] weight Hamming weight of the sparse polynomial
+ */
+void dense_expand(uint64_t *o, const uint32_t *a, uint16_t weight) {
+    memset(o, 0x00, VEC_N_SIZE_64 * sizeof(uint64_t));
+    for (size_t i = 0; i < weight; i++) {
+        const uint32_t index = a[i] >> 6;
+        const uint64_t bit = ((uint64_t) 1) << (a[i] & 0x3F);
+
+        for (uint32_t j = 0; j < VEC_N_SIZE_64; j++) {
+            o[j] |= bit & -(uint64_t) (((j ^ index) - 1) >> 31);
+        }
+    }
+}
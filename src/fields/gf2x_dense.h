@@ -0,0 +1,27 @@
+#ifndef GF2X_DENSE_H
+#define GF2X_DENSE_H
+
+/**
+ * @file gf2x_dense.h
+ * @brief Header file for gf2x_dense.c
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KARATSUBA_THRESHOLD 32 /*!< Largest size in 64-bit words of the schoolbook leaves of the Karatsuba tree */
+
+/**
+ * Schoolbook multiplication used for the leaves of the Karatsuba tree, and the size in 64-bit words
+ * (at most KARATSUBA_THRESHOLD) under which the tree switches to it
+ */
+typedef struct {
+    void (*mul)(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n);
+    size_t threshold;
+} dense_base_t;
+
+void base_mul_portable(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n);
+void dense_mul(uint64_t *o, const uint64_t *a, size_t na, const uint64_t *b, size_t nb, const dense_base_t *base);
+void dense_expand(uint64_t *o, const uint32_t *a, uint16_t weight);
+
+#endif
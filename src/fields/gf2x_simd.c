@@ -0,0 +1,407 @@
+/**
+ * @file gf2x_simd.c
+ * @brief AVX2 and AVX-512 kernels for the multiplications of gf2x.c
+ *
+ * The table kernels mirror the two phases of fast_convolution_mult: building the table of the 16 shifted copies
+ * of the dense operand, and XORing one table row into the result for every coordinate of the sparse operand.
+ * The span kernels XOR the pieces of a row, at a 16-bit granularity, into a reduced result in the cyclic
+ * accumulation of safe_mul.
+ * The barrel kernels rotate the dense operand by one sparse coordinate, in constant time, for the barrel-shifter
+ * multiplication.
+ * The carry-less kernels are the schoolbook leaves of the Karatsuba tree of gf2x_dense.c.
+ * They are compiled with per-function target attributes, so that the dispatcher in gf2x.c can pick them at
+ * runtime depending on the features of the CPU.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "gf2x_dense.h"
+#include "gf2x_simd.h"
+
+#ifdef GF2X_X86_SIMD
+#include <immintrin.h>
+
+
+/**
+ * @brief Builds the table of the shifted copies of a2 (256-bit lanes)
+ *
+ * Row i of the table contains a2(x).x^i and is <b>size</b> + 1 words long.
+ *
+ * @param[out] table Pointer to the table, TABLE * (size + 1) words
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] size Number of 64-bit words of a2
+ */
+__attribute__((target("avx2")))
+void table_build_avx2(uint64_t *table, const uint64_t *a2, uint16_t size) {
+    memcpy(table, a2, size * sizeof(uint64_t));
+    table[size] = 0x0UL;
+
+    for (size_t i = 1; i < TABLE; i++) {
+        uint64_t *row = table + i * (size + 1);
+        const __m128i left = _mm_cvtsi32_si128((int) i);
+        const __m128i right = _mm_cvtsi32_si128((int) (WORD - i));
+        size_t j;
+
+        row[0] = a2[0] << i;
+        for (j = 1; j + 4 <= size; j += 4) {
+            __m256i cur = _mm256_loadu_si256((const __m256i *) (a2 + j));
+            __m256i prev = _mm256_loadu_si256((const __m256i *) (a2 + j - 1));
+            _mm256_storeu_si256((__m256i *) (row + j),
+                                _mm256_or_si256(_mm256_sll_epi64(cur, left), _mm256_srl_epi64(prev, right)));
+        }
+        for (; j < size; j++) {
+            row[j] = (a2[j] << i) | (a2[j - 1] >> (WORD - i));
+        }
+        row[size] = a2[size - 1] >> (WORD - i);
+    }
+}
+
+
+
+/**
+ * @brief XORs the table row selected by each sparse coordinate into the result (256-bit lanes)
+ *
+ * @param[out] o Pointer to the result, at least (a1[i] >> 6) + size + 1 words
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of its monomials)
+ * @param[in] table Pointer to the table built by table_build_avx2
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ */
+__attribute__((target("avx2")))
+void table_accumulate_avx2(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size) {
+    for (size_t i = 0; i < weight; i++) {
+        uint8_t *res = (uint8_t *) o + 2 * (a1[i] >> 4);
+        const uint64_t *row = table + (a1[i] & 0xf) * (size + 1);
+        size_t j;
+
+        for (j = 0; j + 4 <= (size_t) size + 1; j += 4) {
+            __m256i acc = _mm256_loadu_si256((const __m256i *) (res + 8 * j));
+            acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i *) (row + j)));
+            _mm256_storeu_si256((__m256i *) (res + 8 * j), acc);
+        }
+        for (; j < (size_t) size + 1; j++) {
+            uint64_t tmp;
+            memcpy(&tmp, res + 8 * j, 8);
+            tmp ^= row[j];
+            memcpy(res + 8 * j, &tmp, 8);
+        }
+    }
+}
+
+
+
+/**
+ * @brief XORs <b>units</b> unaligned 16-bit units of src into dst (256-bit lanes)
+ *
+ * @param[out] dst Pointer to the destination
+ * @param[in] src Pointer to the source
+ * @param[in] units Number of 16-bit units
+ */
+__attribute__((target("avx2")))
+void span_xor_avx2(uint8_t *dst, const uint8_t *src, size_t units) {
+    size_t j;
+
+    for (j = 0; j + 16 <= units; j += 16) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *) (dst + 2 * j));
+        acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i *) (src + 2 * j)));
+        _mm256_storeu_si256((__m256i *) (dst + 2 * j), acc);
+    }
+    for (; j + 4 <= units; j += 4) {
+        uint64_t a, b;
+        memcpy(&a, dst + 2 * j, 8);
+        memcpy(&b, src + 2 * j, 8);
+        a ^= b;
+        memcpy(dst + 2 * j, &a, 8);
+    }
+    for (; j < units; j++) {
+        uint16_t a, b;
+        memcpy(&a, dst + 2 * j, 2);
+        memcpy(&b, src + 2 * j, 2);
+        a ^= b;
+        memcpy(dst + 2 * j, &a, 2);
+    }
+}
+
+
+
+/**
+ * @brief Builds the table of the shifted copies of a2 (512-bit lanes)
+ *
+ * @param[out] table Pointer to the table, TABLE * (size + 1) words
+ * @param[in] a2 Pointer to the dense polynomial
+ * @param[in] size Number of 64-bit words of a2
+ */
+__attribute__((target("avx512f")))
+void table_build_avx512(uint64_t *table, const uint64_t *a2, uint16_t size) {
+    memcpy(table, a2, size * sizeof(uint64_t));
+    table[size] = 0x0UL;
+
+    for (size_t i = 1; i < TABLE; i++) {
+        uint64_t *row = table + i * (size + 1);
+        const __m128i left = _mm_cvtsi32_si128((int) i);
+        const __m128i right = _mm_cvtsi32_si128((int) (WORD - i));
+        size_t j;
+
+        row[0] = a2[0] << i;
+        for (j = 1; j < size; j += 8) {
+            const __mmask8 m = (size - j) >= 8 ? 0xFF : (__mmask8) ((1U << (size - j)) - 1);
+            __m512i cur = _mm512_maskz_loadu_epi64(m, a2 + j);
+            __m512i prev = _mm512_maskz_loadu_epi64(m, a2 + j - 1);
+            _mm512_mask_storeu_epi64(row + j, m, _mm512_or_si512(_mm512_sll_epi64(cur, left),
+                                                                 _mm512_srl_epi64(prev, right)));
+        }
+        row[size] = a2[size - 1] >> (WORD - i);
+    }
+}
+
+
+
+/**
+ * @brief XORs the table row selected by each sparse coordinate into the result (512-bit lanes)
+ *
+ * @param[out] o Pointer to the result, at least (a1[i] >> 6) + size + 1 words
+ * @param[in] a1 Pointer to the sparse polynomial (list of degrees of its monomials)
+ * @param[in] table Pointer to the table built by table_build_avx512
+ * @param[in] weight Hamming weight of the sparse polynomial
+ * @param[in] size Number of 64-bit words of the dense polynomial
+ */
+__attribute__((target("avx512f")))
+void table_accumulate_avx512(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size) {
+    const size_t words = (size_t) size + 1;
+    const __mmask8 tail = (__mmask8) ((1U << (words % 8)) - 1);
+
+    for (size_t i = 0; i < weight; i++) {
+        uint8_t *res = (uint8_t *) o + 2 * (a1[i] >> 4);
+        const uint64_t *row = table + (a1[i] & 0xf) * words;
+        size_t j;
+
+        for (j = 0; j + 8 <= words; j += 8) {
+            __m512i acc = _mm512_loadu_si512(res + 8 * j);
+            acc = _mm512_xor_si512(acc, _mm512_loadu_si512(row + j));
+            _mm512_storeu_si512(res + 8 * j, acc);
+        }
+        if (tail) {
+            __m512i acc = _mm512_maskz_loadu_epi64(tail, res + 8 * j);
+            acc = _mm512_xor_si512(acc, _mm512_maskz_loadu_epi64(tail, row + j));
+            _mm512_mask_storeu_epi64(res + 8 * j, tail, acc);
+        }
+    }
+}
+
+
+
+/**
+ * @brief XORs <b>units</b> unaligned 16-bit units of src into dst (512-bit lanes, masked tail)
+ *
+ * @param[out] dst Pointer to the destination
+ * @param[in] src Pointer to the source
+ * @param[in] units Number of 16-bit units
+ */
+__attribute__((target("avx512f,avx512bw")))
+void span_xor_avx512(uint8_t *dst, const uint8_t *src, size_t units) {
+    const __mmask32 tail = (__mmask32) ((1ULL << (units % 32)) - 1);
+    size_t j;
+
+    for (j = 0; j + 32 <= units; j += 32) {
+        __m512i acc = _mm512_loadu_si512(dst + 2 * j);
+        acc = _mm512_xor_si512(acc, _mm512_loadu_si512(src + 2 * j));
+        _mm512_storeu_si512(dst + 2 * j, acc);
+    }
+    if (tail) {
+        __m512i acc = _mm512_maskz_loadu_epi16(tail, dst + 2 * j);
+        acc = _mm512_xor_si512(acc, _mm512_maskz_loadu_epi16(tail, src + 2 * j));
+        _mm512_mask_storeu_epi16(dst + 2 * j, tail, acc);
+    }
+}
+
+
+
+/**
+ * @brief Adds to o the n-bit window of x that starts at bit t, with a barrel shifter (256-bit lanes)
+ *
+ * Each stage selects with a mask, without branches, between its input and its input shifted by a power of two
+ * words; the last pass shifts the result by t & 0x3F bits.
+ *
+ * @param[out] o Pointer to the result, <b>words</b> words
+ * @param[in] x Pointer to the doubled operand, <b>words</b> + <b>span</b> words
+ * @param[in] t Bit offset of the window, t >> 6 < span
+ * @param[out] buf Pointer to the scratch, 2 (<b>words</b> + <b>span</b> / 2) words
+ * @param[in] words Number of words of the result
+ * @param[in] span Power of two not smaller than <b>words</b>
+ * @param[in] last Mask of the valid bits of the last word of the result
+ */
+__attribute__((target("avx2")))
+void barrel_accumulate_avx2(uint64_t *o, const uint64_t *x, uint32_t t, uint64_t *buf, size_t words, size_t span, uint64_t last) {
+    const __m128i right = _mm_cvtsi32_si128((int) (t & 0x3F));
+    const __m128i left = _mm_cvtsi32_si128((int) (WORD - (t & 0x3F)));
+    const uint32_t r = t & 0x3F;
+    const uint64_t *cur = x;
+    uint64_t *out = buf;
+    size_t i;
+
+    for (size_t step = span / 2; step > 0; step >>= 1) {
+        const uint64_t mask = -(uint64_t) (((t >> 6) & step) != 0);
+        const __m256i m = _mm256_set1_epi64x((long long) mask);
+        const size_t len = words + step;
+
+        for (i = 0; i + 4 <= len; i += 4) {
+            const __m256i a = _mm256_loadu_si256((const __m256i *) (cur + i));
+            const __m256i b = _mm256_loadu_si256((const __m256i *) (cur + i + step));
+            _mm256_storeu_si256((__m256i *) (out + i), _mm256_xor_si256(a, _mm256_and_si256(m, _mm256_xor_si256(a, b))));
+        }
+        for (; i < len; i++) {
+            out[i] = cur[i] ^ (mask & (cur[i] ^ cur[i + step]));
+        }
+        cur = out;
+        out = out == buf ? buf + words + span / 2 : buf;
+    }
+
+    for (i = 0; i + 4 < words; i += 4) {
+        const __m256i lo = _mm256_loadu_si256((const __m256i *) (cur + i));
+        const __m256i hi = _mm256_loadu_si256((const __m256i *) (cur + i + 1));
+        __m256i acc = _mm256_loadu_si256((const __m256i *) (o + i));
+        acc = _mm256_xor_si256(acc, _mm256_or_si256(_mm256_srl_epi64(lo, right), _mm256_sll_epi64(hi, left)));
+        _mm256_storeu_si256((__m256i *) (o + i), acc);
+    }
+    for (; i < words; i++) {
+        uint64_t w = (cur[i] >> r) | ((cur[i + 1] << 1) << (WORD - 1 - r));
+        o[i] ^= i == words - 1 ? w & last : w;
+    }
+}
+
+
+
+/**
+ * @brief Adds to o the n-bit window of x that starts at bit t, with a barrel shifter (512-bit lanes)
+ *
+ * Only the stages that shift by at least eight words go through memory, so that both loads of a stage have the
+ * same alignment; the remaining shift by (t >> 6) & 7 words and t & 0x3F bits is applied in registers with a
+ * two-source permutation and shifts of variable count.
+ *
+ * @param[out] o Pointer to the result, <b>words</b> words
+ * @param[in] x Pointer to the doubled operand, <b>words</b> + <b>span</b> words
+ * @param[in] t Bit offset of the window, t >> 6 < span
+ * @param[out] buf Pointer to the scratch, 2 (<b>words</b> + <b>span</b> / 2) words
+ * @param[in] words Number of words of the result
+ * @param[in] span Power of two not smaller than <b>words</b>, at least 16
+ * @param[in] last Mask of the valid bits of the last word of the result
+ */
+__attribute__((target("avx512f")))
+void barrel_accumulate_avx512(uint64_t *o, const uint64_t *x, uint32_t t, uint64_t *buf, size_t words, size_t span, uint64_t last) {
+    const __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i idx_lo = _mm512_add_epi64(lane, _mm512_set1_epi64((long long) ((t >> 6) & 7)));
+    const __m512i idx_hi = _mm512_add_epi64(idx_lo, _mm512_set1_epi64(1));
+    const __m512i right = _mm512_set1_epi64((long long) (t & 0x3F));
+    const __m512i left = _mm512_set1_epi64((long long) (WORD - (t & 0x3F)));
+    const uint64_t *cur = x;
+    uint64_t *out = buf;
+    size_t i;
+
+    for (size_t step = span / 2; step >= 8; step >>= 1) {
+        const __m512i m = _mm512_set1_epi64(-(long long) (((t >> 6) & step) != 0));
+        const size_t len = words + step;
+        const __mmask8 tail = (__mmask8) ((1U << (len % 8)) - 1);
+
+        for (i = 0; i + 8 <= len; i += 8) {
+            const __m512i a = _mm512_loadu_si512(cur + i);
+            const __m512i b = _mm512_loadu_si512(cur + i + step);
+            _mm512_storeu_si512(out + i, _mm512_ternarylogic_epi64(m, a, b, 0xAC));
+        }
+        if (tail) {
+            const __m512i a = _mm512_maskz_loadu_epi64(tail, cur + i);
+            const __m512i b = _mm512_maskz_loadu_epi64(tail, cur + i + step);
+            _mm512_mask_storeu_epi64(out + i, tail, _mm512_ternarylogic_epi64(m, a, b, 0xAC));
+        }
+        cur = out;
+        out = out == buf ? buf + words + span / 2 : buf;
+    }
+
+    // cur holds words + 8 valid words, and output word i needs cur[i + ((t >> 6) & 7)] and the next one
+    for (i = 0; i < words; i += 8) {
+        const __mmask8 valid = (words - i) >= 8 ? 0xFF : (__mmask8) ((1U << (words - i)) - 1);
+        const __m512i v0 = _mm512_loadu_si512(cur + i);
+        const __m512i v1 = _mm512_maskz_loadu_epi64(valid, cur + i + 8);
+        const __m512i lo = _mm512_permutex2var_epi64(v0, idx_lo, v1);
+        const __m512i hi = _mm512_permutex2var_epi64(v0, idx_hi, v1);
+        __m512i w = _mm512_or_si512(_mm512_srlv_epi64(lo, right), _mm512_sllv_epi64(hi, left));
+
+        if (i + 8 >= words) {
+            w = _mm512_and_si512(w, _mm512_mask_set1_epi64(_mm512_set1_epi64(-1), (__mmask8) (1U << ((words - 1) % 8)), (long long) last));
+        }
+        _mm512_mask_storeu_epi64(o + i, valid, _mm512_xor_si512(_mm512_maskz_loadu_epi64(valid, o + i), w));
+    }
+}
+
+
+
+/**
+ * @brief Schoolbook multiplication of two polynomials of n <= KARATSUBA_THRESHOLD words (PCLMULQDQ)
+ *
+ * @param[out] o Pointer to the result, 2n words
+ * @param[in] a Pointer to the first polynomial
+ * @param[in] b Pointer to the second polynomial
+ * @param[in] n Number of 64-bit words of the operands
+ */
+__attribute__((target("pclmul,sse4.1")))
+void base_mul_pclmul(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n) {
+    __m128i acc[2 * KARATSUBA_THRESHOLD];
+
+    memset(acc, 0x00, sizeof(acc));
+    for (size_t i = 0; i < n; i++) {
+        const __m128i ai = _mm_cvtsi64_si128((long long) a[i]);
+        for (size_t j = 0; j < n; j++) {
+            acc[i + j] = _mm_xor_si128(acc[i + j], _mm_clmulepi64_si128(ai, _mm_cvtsi64_si128((long long) b[j]), 0x00));
+        }
+    }
+
+    o[0] = (uint64_t) _mm_cvtsi128_si64(acc[0]);
+    for (size_t k = 1; k < 2 * n; k++) {
+        o[k] = (uint64_t) _mm_cvtsi128_si64(acc[k]) ^ (uint64_t) _mm_extract_epi64(acc[k - 1], 1);
+    }
+}
+
+
+
+/**
+ * @brief Schoolbook multiplication of two polynomials of n <= KARATSUBA_THRESHOLD words (VPCLMULQDQ)
+ *
+ * The result is computed eight words at a time. The 128-bit lanes of the first accumulator receive the
+ * products a[i].b[j] with i + j even, the ones of the second accumulator the products with i + j odd, which
+ * land one word higher; for a fixed i the words of b involved are every other word of an unaligned load.
+ *
+ * @param[out] o Pointer to the result, 2n words
+ * @param[in] a Pointer to the first polynomial
+ * @param[in] b Pointer to the second polynomial
+ * @param[in] n Number of 64-bit words of the operands
+ */
+__attribute__((target("avx512f,vpclmulqdq")))
+void base_mul_vpclmul(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n) {
+    uint64_t padded[3 * KARATSUBA_THRESHOLD + 8] = {0};
+    uint64_t res[2 * KARATSUBA_THRESHOLD + 16] = {0};
+    const uint64_t *bp = padded + KARATSUBA_THRESHOLD;
+
+    memcpy(padded + KARATSUBA_THRESHOLD, b, n * sizeof(uint64_t));
+
+    for (size_t w = 0; w < 2 * n; w += 8) {
+        __m512i even = _mm512_setzero_si512();
+        __m512i odd = _mm512_setzero_si512();
+
+        for (size_t i = 0; i < n; i += 2) {
+            const __m512i ai = _mm512_set1_epi64((long long) a[i]);
+            even = _mm512_xor_si512(even, _mm512_clmulepi64_epi128(ai, _mm512_loadu_si512(bp + w - i), 0x00));
+            odd = _mm512_xor_si512(odd, _mm512_clmulepi64_epi128(ai, _mm512_loadu_si512(bp + w - i), 0x10));
+        }
+        for (size_t i = 1; i < n; i += 2) {
+            const __m512i ai = _mm512_set1_epi64((long long) a[i]);
+            even = _mm512_xor_si512(even, _mm512_clmulepi64_epi128(ai, _mm512_loadu_si512(bp + w - i - 1), 0x10));
+            odd = _mm512_xor_si512(odd, _mm512_clmulepi64_epi128(ai, _mm512_loadu_si512(bp + w - i + 1), 0x00));
+        }
+
+        _mm512_storeu_si512(res + w, _mm512_xor_si512(_mm512_loadu_si512(res + w), even));
+        _mm512_storeu_si512(res + w + 1, _mm512_xor_si512(_mm512_loadu_si512(res + w + 1), odd));
+    }
+
+    memcpy(o, res, 2 * n * sizeof(uint64_t));
+}
+#endif
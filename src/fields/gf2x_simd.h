@@ -0,0 +1,35 @@
+#ifndef GF2X_SIMD_H
+#define GF2X_SIMD_H
+
+/**
+ * @file gf2x_simd.h
+ * @brief Header file for gf2x_simd.c
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TABLE 16
+#define WORD 64
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define GF2X_X86_SIMD
+#endif
+
+#ifdef GF2X_X86_SIMD
+void table_build_avx2(uint64_t *table, const uint64_t *a2, uint16_t size);
+void table_accumulate_avx2(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size);
+void span_xor_avx2(uint8_t *dst, const uint8_t *src, size_t units);
+
+void table_build_avx512(uint64_t *table, const uint64_t *a2, uint16_t size);
+void table_accumulate_avx512(uint64_t *o, const uint32_t *a1, const uint64_t *table, uint16_t weight, uint16_t size);
+void span_xor_avx512(uint8_t *dst, const uint8_t *src, size_t units);
+
+void barrel_accumulate_avx2(uint64_t *o, const uint64_t *x, uint32_t t, uint64_t *buf, size_t words, size_t span, uint64_t last);
+void barrel_accumulate_avx512(uint64_t *o, const uint64_t *x, uint32_t t, uint64_t *buf, size_t words, size_t span, uint64_t last);
+
+void base_mul_pclmul(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n);
+void base_mul_vpclmul(uint64_t *o, const uint64_t *a, const uint64_t *b, size_t n);
+#endif
+
+#endif
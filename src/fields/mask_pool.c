@@ -0,0 +1,291 @@
+/**
+ * @file mask_pool.c
+ * @brief Pool of masks precomputed by a background thread
+ *
+ * The masks of the masked routines do not depend on their inputs: the dense masks of shares_add and the supports
+ * of the fixed-weight masks of the safe_mul cross terms, of weight PARAM_OMEGA and PARAM_OMEGA_R, can be generated
+ * ahead of time. With MASK_POOL defined (POOL in CMake) a producer thread, started with mask_pool_start, keeps one
+ * bounded ring of MASK_POOL items per kind of mask full, and the masked routines take their masks from the rings.
+ * An empty ring is not waited for: the take functions fail and the caller generates the mask inline.
+ * The producer draws from a SHAKE-256 state of its own, seeded from the default context when the pool starts, and
+ * runs with the idle scheduling class where the system has it, so that it fills the rings between the operations
+ * rather than during them.
+ */
+
+#ifdef MASK_POOL
+    #define _GNU_SOURCE
+#endif
+
+#include "mask_pool.h"
+
+#ifdef MASK_POOL
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "../common/parameters.h"
+#include "../common/vector.h"
+#include "../lib/mask_rng.h"
+#include "../lib/hqc_rng.h"
+#include "../lib/shake_prng.h"
+
+#define MASK_POOL_KINDS 3 /*!< Dense masks, supports of weight PARAM_OMEGA, supports of weight PARAM_OMEGA_R */
+
+// a dense mask is generated as a refill of mask_rng_expand
+#if MASK_RNG_BUFFER_BYTES < VEC_N_SIZE_BYTES
+    #error INVALID MASK_RNG_BUFFER_BYTES
+#endif
+
+/**
+ * Bounded ring of one kind of mask: count items from head, modulo MASK_POOL
+ */
+typedef struct {
+    uint8_t *items;
+    size_t bytes;
+    uint16_t weight;
+    size_t head;
+    size_t count;
+} mask_ring_t;
+
+static uint64_t pool_dense[MASK_POOL][VEC_N_SIZE_64];
+static uint32_t pool_support[2][MASK_POOL][PARAM_OMEGA_R];
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t space;
+    pthread_t thread;
+    int running;
+    int stop;
+    size_t hits;
+    size_t misses;
+    shake256incctx prng;
+    mask_ring_t ring[MASK_POOL_KINDS];
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+          .ring = {{(uint8_t *) pool_dense, VEC_N_SIZE_BYTES, 0, 0, 0},
+                   {(uint8_t *) pool_support[0], PARAM_OMEGA * sizeof(uint32_t), PARAM_OMEGA, 0, 0},
+                   {(uint8_t *) pool_support[1], PARAM_OMEGA_R * sizeof(uint32_t), PARAM_OMEGA_R, 0, 0}}};
+
+
+/**
+ * @brief Generates an item of a ring with the prng of the producer
+ *
+ * @param[out] item Pointer to the item, MASK_RNG_BUFFER_BYTES bytes for the dense masks
+ * @param[in] ring Pointer to the ring
+ */
+static void mask_pool_generate(uint8_t *item, const mask_ring_t *ring) {
+    uint8_t key[MASK_RNG_KEY_BYTES];
+    uint8_t seed[SEED_BYTES];
+    seedexpander_state seedexpander;
+
+    if (ring->weight == 0) {
+        shake256_inc_squeeze(key, MASK_RNG_KEY_BYTES, &pool.prng);
+        mask_rng_expand(item, key);
+        memset(key, 0x00, MASK_RNG_KEY_BYTES);
+    } else {
+        shake256_inc_squeeze(seed, SEED_BYTES, &pool.prng);
+        seedexpander_init(&seedexpander, seed, SEED_BYTES);
+        vect_set_random_fixed_weight_by_coordinates(&seedexpander, (uint32_t *) item, ring->weight);
+        memset(seed, 0x00, SEED_BYTES);
+    }
+}
+
+
+static void *mask_pool_main(void *arg) {
+    uint8_t item[MASK_RNG_BUFFER_BYTES];
+    (void) arg;
+
+#ifdef SCHED_IDLE
+    const struct sched_param param = {0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        mask_ring_t *ring = &pool.ring[0];
+
+        // the emptiest ring first
+        for (size_t k = 1; k < MASK_POOL_KINDS; k++) {
+            if (pool.ring[k].count < ring->count) {
+                ring = &pool.ring[k];
+            }
+        }
+        while (!pool.stop && ring->count == MASK_POOL) {
+            pthread_cond_wait(&pool.space, &pool.lock);
+            for (size_t k = 0; k < MASK_POOL_KINDS; k++) {
+                if (pool.ring[k].count < ring->count) {
+                    ring = &pool.ring[k];
+                }
+            }
+        }
+        if (pool.stop) {
+            break;
+        }
+
+        pthread_mutex_unlock(&pool.lock);
+        mask_pool_generate(item, ring);
+        pthread_mutex_lock(&pool.lock);
+
+        memcpy(ring->items + ((ring->head + ring->count) % MASK_POOL) * ring->bytes, item, ring->bytes);
+        ring->count++;
+    }
+    pthread_mutex_unlock(&pool.lock);
+    memset(item, 0x00, MASK_RNG_BUFFER_BYTES);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Takes the oldest item of a ring, if the pool runs and the ring is not empty
+ *
+ * @param[out] item Pointer to the item
+ * @param[in] kind Index of the ring
+ * @returns 1 if an item was taken, 0 otherwise
+ */
+static int mask_pool_take(uint8_t *item, size_t kind) {
+    mask_ring_t *ring = &pool.ring[kind];
+    int taken = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.running && ring->count > 0) {
+        uint8_t *slot = ring->items + ring->head * ring->bytes;
+
+        memcpy(item, slot, ring->bytes);
+        memset(slot, 0x00, ring->bytes);
+        ring->head = (ring->head + 1) % MASK_POOL;
+        ring->count--;
+        pool.hits++;
+        pthread_cond_signal(&pool.space);
+        taken = 1;
+    } else if (pool.running) {
+        pool.misses++;
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    return taken;
+}
+#endif
+
+
+/**
+ * @brief Seeds the producer from the default context and starts it, the rings starting empty
+ *
+ * @returns 1 if the producer runs, 0 without MASK_POOL, if the default context cannot generate random bytes or if the
+ * thread could not be created
+ */
+int mask_pool_start(void) {
+#ifdef MASK_POOL
+    uint8_t seed[SEED_BYTES];
+    uint8_t domain = MASK_POOL_DOMAIN;
+
+    mask_pool_stop();
+    if (hqc_rng_bytes(hqc_rng_default(), seed, SEED_BYTES) != 0) {
+        return 0;
+    }
+    shake256_inc_init(&pool.prng);
+    shake256_inc_absorb(&pool.prng, seed, SEED_BYTES);
+    shake256_inc_absorb(&pool.prng, &domain, 1);
+    shake256_inc_finalize(&pool.prng);
+    memset(seed, 0x00, SEED_BYTES);
+
+    pool.stop = 0;
+    pool.hits = 0;
+    pool.misses = 0;
+    if (pthread_create(&pool.thread, NULL, mask_pool_main, NULL) != 0) {
+        return 0;
+    }
+    pool.running = 1;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Stops the producer and discards the masks left in the rings
+ */
+void mask_pool_stop(void) {
+#ifdef MASK_POOL
+    if (!pool.running) {
+        return;
+    }
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = 1;
+    pool.running = 0;
+    pthread_cond_signal(&pool.space);
+    pthread_mutex_unlock(&pool.lock);
+    pthread_join(pool.thread, NULL);
+
+    for (size_t k = 0; k < MASK_POOL_KINDS; k++) {
+        memset(pool.ring[k].items, 0x00, MASK_POOL * pool.ring[k].bytes);
+        pool.ring[k].head = 0;
+        pool.ring[k].count = 0;
+    }
+#endif
+}
+
+
+/**
+ * @brief Takes a dense mask from the pool
+ *
+ * @param[out] mask Pointer to the mask, VEC_N_SIZE_64 words
+ * @returns 1 if a mask was taken, 0 if the caller has to generate it
+ */
+int mask_pool_take_dense(uint64_t *mask) {
+#ifdef MASK_POOL
+    return mask_pool_take((uint8_t *) mask, 0);
+#else
+    (void) mask;
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Takes the support of a fixed-weight mask from the pool and sets its bits in s, as
+ * vect_set_random_fixed_weight does
+ *
+ * @param[in,out] s Pointer to the mask, VEC_N_SIZE_64 words
+ * @param[in] weight Weight of the mask, PARAM_OMEGA or PARAM_OMEGA_R for the pool to have it
+ * @returns 1 if a mask was taken, 0 if the caller has to generate it
+ */
+int mask_pool_take_fixed_weight(uint64_t *s, uint16_t weight) {
+#ifdef MASK_POOL
+    uint32_t support[PARAM_OMEGA_R];
+    const size_t kind = weight == PARAM_OMEGA ? 1 : 2;
+
+    if ((weight != PARAM_OMEGA && weight != PARAM_OMEGA_R) || !mask_pool_take((uint8_t *) support, kind)) {
+        return 0;
+    }
+    for (size_t i = 0; i < weight; i++) {
+        s[support[i] / 64] |= ((uint64_t) 1) << (support[i] % 64);
+    }
+    memset(support, 0x00, sizeof(support));
+    return 1;
+#else
+    (void) s;
+    (void) weight;
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Number of masks taken from the pool and of masks generated inline because a ring was empty, since the
+ * last mask_pool_start
+ *
+ * @param[out] hits Pointer to the number of masks taken from the pool
+ * @param[out] misses Pointer to the number of masks generated inline
+ */
+void mask_pool_stats(size_t *hits, size_t *misses) {
+#ifdef MASK_POOL
+    pthread_mutex_lock(&pool.lock);
+    *hits = pool.hits;
+    *misses = pool.misses;
+    pthread_mutex_unlock(&pool.lock);
+#else
+    *hits = 0;
+    *misses = 0;
+#endif
+}
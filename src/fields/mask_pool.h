@@ -0,0 +1,18 @@
+#ifndef MASK_POOL_H
+#define MASK_POOL_H
+
+/**
+ * @file mask_pool.h
+ * @brief Header file of mask_pool.c
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+int mask_pool_start(void);
+void mask_pool_stop(void);
+int mask_pool_take_dense(uint64_t *mask);
+int mask_pool_take_fixed_weight(uint64_t *s, uint16_t weight);
+void mask_pool_stats(size_t *hits, size_t *misses);
+
+#endif
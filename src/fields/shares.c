@@ -1,60 +1,456 @@
 #include "shares.h"
+#include "shares_simd.h"
+#include "mask_pool.h"
+#include "../lib/hqc_rng.h"
+#include "../lib/mask_rng.h"
 #include <string.h>
 
+#define REFRESH_CHUNK 64 /*!< Words of the vectors summed, and of the mask drawn, per step of shares_add_reduce */
+#define MASK_CANDIDATES 64 /*!< 16-bit words of keystream drawn at once by the fixed-weight mask sampler */
+#define MASK_THRESHOLD ((1 << 16) / PARAM_N * PARAM_N) /*!< Words of the keystream accepted by the sampler */
+
+static size_t mask_candidates_scalar(uint32_t *out, const uint16_t *in, size_t n);
+#ifdef SHARES_X86_SIMD
+static size_t mask_candidates_avx512(uint32_t *out, const uint16_t *in, size_t n);
+#endif
+
+/**
+ * Rejection kernel of the fixed-weight mask sampler and its instruction set
+ */
+typedef struct {
+    shares_isa_t isa;
+    size_t (*mask_candidates)(uint32_t *, const uint16_t *, size_t);
+} shares_kernels_t;
+
+static const shares_kernels_t shares_kernels_scalar = {SHARES_ISA_SCALAR, mask_candidates_scalar};
+#ifdef SHARES_X86_SIMD
+static const shares_kernels_t shares_kernels_avx512 = {SHARES_ISA_AVX512, mask_candidates_avx512};
+#endif
+
+/**
+ * Selected kernel, NULL until the first use or shares_set_isa; published with a single atomic store where the
+ * compiler has them, so that the threads of the callers and of the mask pool can sample side by side
+ */
+static const shares_kernels_t *shares_kernels = NULL;
+
+#ifdef __GNUC__
+    #define SHARES_LOAD(v) __atomic_load_n(&(v), __ATOMIC_ACQUIRE)
+    #define SHARES_STORE(v, x) __atomic_store_n(&(v), (x), __ATOMIC_RELEASE)
+    #define SHARES_CAS(v, expected, x) __atomic_compare_exchange_n(&(v), &(expected), (x), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+    #define SHARES_LOAD(v) (v)
+    #define SHARES_STORE(v, x) ((v) = (x))
+    #define SHARES_CAS(v, expected, x) ((v) == (expected) ? ((v) = (x), 1) : ((expected) = (v), 0))
+#endif
+
+static shares_refresh_t shares_refresh = SHARES_REFRESH_FIXED_WEIGHT;
+
+/**
+ * Supports of the masks of the cross terms of safe_mul, sampled together by mask_batch_refill and handed out in
+ * order by shares_mask_cross_term; one batch per thread, dropped when the context of the masks changes
+ */
+static HQC_THREAD_LOCAL struct {
+    const hqc_rng *rng;
+    uint16_t weight;
+    size_t next;
+    size_t count;
+    uint32_t support[MASKS_MAX * (MASKS_MAX - 1) / 2 + 1][PARAM_OMEGA_R];
+} mask_batch;
+
+/**
+ * Number of shares of the builds with MASK_LVL = 0, set with shares_set_masks
+ */
+unsigned shares_masks_runtime = 2;
+
+
+/**
+ * @brief Sets the number of shares of the masked routines
+ *
+ * Only the builds with MASK_LVL = 0 can change it; the others keep MASK_LVL shares. The shares_t already
+ * computed are not converted, the new number applies to the next masked operations.
+ *
+ * @param[in] masks Number of shares, from 1 to MASKS_MAX
+ * @returns the number of shares actually used
+ */
+unsigned shares_set_masks(unsigned masks) {
+#if MASKS == 0
+    if (masks >= 1 && masks <= MASKS_MAX) {
+        shares_masks_runtime = masks;
+    }
+#else
+    (void) masks;
+#endif
+    return shares_masks();
+}
+
+
+/**
+ * @brief Draws a dense mask, from the mask pool when it runs and has one, from mask_rng otherwise
+ *
+ * The mask is reduced: its bits above PARAM_N, and the bytes of its last word past VEC_N_SIZE_BYTES, are zero, so
+ * that adding it to a share keeps the share reduced.
+ *
+ * @param[out] mask Pointer to the mask, VEC_N_SIZE_64 words
+ */
+void shares_mask_dense(uint64_t *mask) {
+    if (!mask_pool_take_dense(mask)) {
+        mask_rng((uint8_t *)mask, VEC_N_SIZE_BYTES);
+    }
+    mask[VEC_N_SIZE_64 - 1] &= RED_MASK;
+}
+
+
+/**
+ * @brief Widest kernel the CPU supports up to <b>isa</b>
+ */
+static const shares_kernels_t *shares_pick(shares_isa_t isa) {
+#ifdef SHARES_X86_SIMD
+    __builtin_cpu_init();
+    if ((isa == SHARES_ISA_AUTO || isa == SHARES_ISA_AVX512) && __builtin_cpu_supports("avx512f")) {
+        return &shares_kernels_avx512;
+    }
+#else
+    (void) isa;
+#endif
+    return &shares_kernels_scalar;
+}
+
+
+/**
+ * @brief Kernel of the next batch, the one of SHARES_ISA_AUTO unless shares_set_isa picked another
+ */
+static const shares_kernels_t *shares_current(void) {
+    const shares_kernels_t *kernels = SHARES_LOAD(shares_kernels);
+
+    if (kernels == NULL) {
+        // a shares_set_isa of another thread in the meantime wins
+        SHARES_CAS(shares_kernels, kernels, shares_pick(SHARES_ISA_AUTO));
+        kernels = SHARES_LOAD(shares_kernels);
+    }
+    return kernels;
+}
+
+
+/**
+ * @brief Samples the supports of <b>count</b> masks of Hamming weight <b>weight</b> from the keystream of
+ * mask_rng into the batch
+ *
+ * The 16-bit words of the keystream below MASK_THRESHOLD, a multiple of PARAM_N, are reduced modulo PARAM_N by the
+ * candidates kernel; a bitmap of the positions already drawn drops the duplicates in a single pass.
+ *
+ * @param[in] weight Integer that is the Hamming weight
+ * @param[in] count Number of masks
+ */
+static void mask_batch_refill(uint16_t weight, size_t count) {
+    uint16_t words[MASK_CANDIDATES];
+    uint32_t candidates[MASK_CANDIDATES];
+    uint64_t seen[VEC_N_SIZE_64] = {0};
+    const shares_kernels_t *kernels = shares_current();
+
+    for (size_t b = 0; b < count; b++) {
+        uint32_t *support = mask_batch.support[b];
+        size_t k = 0;
+
+        while (k < weight) {
+            mask_rng((uint8_t *)words, sizeof(words));
+            const size_t n = kernels->mask_candidates(candidates, words, MASK_CANDIDATES);
+
+            for (size_t c = 0; c < n && k < weight; c++) {
+                const uint32_t pos = candidates[c];
+                const uint64_t bit = (uint64_t) 1 << (pos % 64);
+
+                support[k] = pos;
+                k += (seen[pos / 64] & bit) == 0;
+                seen[pos / 64] |= bit;
+            }
+        }
+        for (size_t c = 0; c < weight; c++) {
+            seen[support[c] / 64] = 0;
+        }
+    }
+    mask_batch.rng = hqc_rng_current();
+    mask_batch.weight = weight;
+    mask_batch.next = 0;
+    mask_batch.count = count;
+}
+
+
+/**
+ * @brief Draws the mask of a cross term of safe_mul
+ *
+ * With SHARES_REFRESH_FIXED_WEIGHT, the default, the bits of a random mask of Hamming weight <b>weight</b> are set
+ * in s, as vect_set_random_fixed_weight does; the mask comes from the mask pool when it runs and has one, from a
+ * batch of the masks of all the cross terms of a multiplication otherwise. With SHARES_REFRESH_DENSE s is
+ * overwritten with a uniformly random vector.
+ *
+ * @param[in,out] s Pointer to the mask, VEC_N_SIZE_64 words
+ * @param[in] weight Integer that is the Hamming weight
+ */
+void shares_mask_cross_term(uint64_t *s, uint16_t weight) {
+    const size_t masks = shares_masks();
+
+    if (shares_refresh == SHARES_REFRESH_DENSE) {
+        shares_mask_dense(s);
+        return;
+    }
+    if (mask_pool_take_fixed_weight(s, weight)) {
+        return;
+    }
+    if (mask_batch.next == mask_batch.count || mask_batch.weight != weight || mask_batch.rng != hqc_rng_current()) {
+        mask_batch_refill(weight, masks > 1 ? masks * (masks - 1) / 2 : 1);
+    }
+
+    const uint32_t *support = mask_batch.support[mask_batch.next++];
+    for (size_t i = 0; i < weight; i++) {
+        s[support[i] / 64] |= (uint64_t) 1 << (support[i] % 64);
+    }
+}
+
+
+/**
+ * @brief Selects the masks of the cross terms of safe_mul
+ *
+ * @param[in] refresh SHARES_REFRESH_FIXED_WEIGHT for masks of the weight of the sparse operand, as in the
+ * reference masked multiplication, SHARES_REFRESH_DENSE for uniformly random ones
+ * @returns the previous choice
+ */
+shares_refresh_t shares_set_refresh(shares_refresh_t refresh) {
+    const shares_refresh_t previous = shares_refresh;
+
+    shares_refresh = refresh;
+    return previous;
+}
+
+
+/**
+ * @brief Reduces the 16-bit words below MASK_THRESHOLD modulo PARAM_N and drops the others, without branches
+ *
+ * @param[out] out Pointer to the accepted positions, n words
+ * @param[in] in Pointer to the words of the keystream
+ * @param[in] n Number of words
+ * @returns the number of accepted positions
+ */
+static size_t mask_candidates_scalar(uint32_t *out, const uint16_t *in, size_t n) {
+    size_t k = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        out[k] = in[i] % PARAM_N;
+        k += in[i] < MASK_THRESHOLD;
+    }
+    return k;
+}
+
+
+#ifdef SHARES_X86_SIMD
+static size_t mask_candidates_avx512(uint32_t *out, const uint16_t *in, size_t n) {
+    return shares_mask_candidates_avx512(out, in, n, PARAM_N, MASK_THRESHOLD);
+}
+#endif
+
+
+/**
+ * @brief Splits a vector of PARAM_N1N2 bits in shares
+ *
+ * Share j holds the words j.(VEC_N1N2_SIZE_64/MASKS) to (j + 1).(VEC_N1N2_SIZE_64/MASKS) - 1 of the vector and
+ * zeros elsewhere, the last share holding the remaining bytes.
+ *
+ * @param[out] shares Pointer to the shares, initialized to zero
+ * @param[in] in Pointer to the vector, VEC_N1N2_SIZE_BYTES bytes
+ */
 void shares_resize(shares_t *shares, const uint64_t *in) {
-    uint64_t mask[VEC_N_SIZE_64];
-    shake_prng((uint8_t *)mask, VEC_N_SIZE_BYTES);
 #if MASKS == 1
-    memcpy(shares->s0, in, VEC_N1N2_SIZE_BYTES);
+    memcpy(shares->s[0], in, VEC_N1N2_SIZE_BYTES);
 #elif MASKS == 2
-    memcpy(shares->s0, in, VEC_N1N2_SIZE_BYTES/2);
-    memcpy(shares->s1+VEC_N1N2_SIZE_64/2, in+VEC_N1N2_SIZE_64/2, VEC_N_SIZE_BYTES-VEC_N1N2_SIZE_BYTES/2);
+    memcpy(shares->s[0], in, VEC_N1N2_SIZE_64/2*8);
+    memcpy(shares->s[1]+VEC_N1N2_SIZE_64/2, in+VEC_N1N2_SIZE_64/2, VEC_N1N2_SIZE_BYTES - VEC_N1N2_SIZE_64/2*8);
 #elif MASKS == 3
-    memcpy(shares->s0, in, VEC_N1N2_SIZE_BYTES/3);
-    memcpy(shares->s1+(VEC_N1N2_SIZE_64/3)*1, in+(VEC_N1N2_SIZE_64/3)*1, VEC_N1N2_SIZE_BYTES/3);
-    memcpy(shares->s2+(VEC_N1N2_SIZE_64/3)*2, in+(VEC_N1N2_SIZE_64/3)*2, VEC_N1N2_SIZE_BYTES - (VEC_N1N2_SIZE_BYTES/3)*2);
+    memcpy(shares->s[0], in, VEC_N1N2_SIZE_64/3*8);
+    memcpy(shares->s[1]+VEC_N1N2_SIZE_64/3*1, in+VEC_N1N2_SIZE_64/3*1, VEC_N1N2_SIZE_64/3*8);
+    memcpy(shares->s[2]+VEC_N1N2_SIZE_64/3*2, in+VEC_N1N2_SIZE_64/3*2, VEC_N1N2_SIZE_BYTES - VEC_N1N2_SIZE_64/3*2*8);
 #elif MASKS == 4
-    memcpy(shares->s0, in, VEC_N1N2_SIZE_BYTES/4);
-    memcpy(shares->s1+VEC_N1N2_SIZE_64/4*1, in+VEC_N1N2_SIZE_64/4*1, VEC_N1N2_SIZE_BYTES/4);
-    memcpy(shares->s2+VEC_N1N2_SIZE_64/4*2, in+VEC_N1N2_SIZE_64/4*2, VEC_N1N2_SIZE_BYTES/4);
-    memcpy(shares->s3+VEC_N1N2_SIZE_64/4*3, in+VEC_N1N2_SIZE_64/4*3, VEC_N1N2_SIZE_BYTES - VEC_N1N2_SIZE_BYTES/4*3);
+    memcpy(shares->s[0], in, VEC_N1N2_SIZE_64/4*8);
+    memcpy(shares->s[1]+VEC_N1N2_SIZE_64/4*1, in+VEC_N1N2_SIZE_64/4*1, VEC_N1N2_SIZE_64/4*8);
+    memcpy(shares->s[2]+VEC_N1N2_SIZE_64/4*2, in+VEC_N1N2_SIZE_64/4*2, VEC_N1N2_SIZE_64/4*8);
+    memcpy(shares->s[3]+VEC_N1N2_SIZE_64/4*3, in+VEC_N1N2_SIZE_64/4*3, VEC_N1N2_SIZE_BYTES - VEC_N1N2_SIZE_64/4*3*8);
+#else
+    const unsigned masks = shares_masks();
+    const size_t part = VEC_N1N2_SIZE_64 / masks;
+
+    for (unsigned j = 0; j < masks - 1; j++) {
+        memcpy(shares->s[j] + part * j, in + part * j, part * 8);
+    }
+    memcpy(shares->s[masks - 1] + part * (masks - 1), in + part * (masks - 1), VEC_N1N2_SIZE_BYTES - part * (masks - 1) * 8);
 #endif
 }
 
+
+/**
+ * @brief Adds two shared vectors, share by share
+ *
+ * A fresh mask is added to two shares of b in each half of the vectors, so that it cancels out in the sum of the
+ * shares: shares 0 and 1 with two shares, 0 and 2 then 0 and 1 with three, 0 and 2 then 1 and 3 with four or
+ * more.
+ *
+ * @param[out] o Pointer to the sum, may be a or b
+ * @param[in] a Pointer to the first shared vector
+ * @param[in] b Pointer to the second shared vector
+ */
 void shares_add(shares_t *o, shares_t *a, shares_t *b) {
+#if MASKS != 1
     uint64_t mask[VEC_N_SIZE_64];
-    shake_prng((uint8_t *)mask, VEC_N_SIZE_BYTES);
+#endif
+#if MASKS > 1
+    shares_mask_dense(mask);
+#endif
 #if MASKS == 1
     for(int i = 0; i < VEC_N_SIZE_64; i++)
-        o->s0[i] = a->s0[i] ^ b->s0[i];
+        o->s[0][i] = a->s[0][i] ^ b->s[0][i];
 #elif MASKS == 2
     for(int i = 0; i < VEC_N_SIZE_64; i++) {
-        o->s0[i] = a->s0[i] ^ (b->s0[i] ^ mask[i]);
-        o->s1[i] = (a->s1[i] ^ mask[i]) ^ b->s1[i];
+        o->s[0][i] = a->s[0][i] ^ (b->s[0][i] ^ mask[i]);
+        o->s[1][i] = (a->s[1][i] ^ mask[i]) ^ b->s[1][i];
     }
 #elif MASKS == 3
     for(int i = 0; i < VEC_N_SIZE_64/2; i++) {
-        o->s0[i] = a->s0[i] ^ (b->s0[i] ^ mask[i]);
-        o->s1[i] = a->s1[i] ^ b->s1[i];
-        o->s2[i] = a->s2[i] ^ (b->s2[i] ^ mask[i]);
+        o->s[0][i] = a->s[0][i] ^ (b->s[0][i] ^ mask[i]);
+        o->s[1][i] = a->s[1][i] ^ b->s[1][i];
+        o->s[2][i] = a->s[2][i] ^ (b->s[2][i] ^ mask[i]);
     }
     for(int i = VEC_N_SIZE_64/2; i < VEC_N_SIZE_64; i++) {
-        o->s0[i] = a->s0[i] ^ (b->s0[i] ^ mask[i]);
-        o->s1[i] = a->s1[i] ^ (b->s1[i] ^ mask[i]);
-        o->s2[i] = a->s2[i] ^ b->s2[i];
+        o->s[0][i] = a->s[0][i] ^ (b->s[0][i] ^ mask[i]);
+        o->s[1][i] = a->s[1][i] ^ (b->s[1][i] ^ mask[i]);
+        o->s[2][i] = a->s[2][i] ^ b->s[2][i];
     }
 #elif MASKS == 4
     for(int i = 0; i < VEC_N_SIZE_64/2; i++) {
-        o->s0[i] = a->s0[i] ^ (b->s0[i] ^ mask[i]);
-        o->s1[i] = a->s1[i] ^ b->s1[i];
-        o->s2[i] = a->s2[i] ^ (b->s2[i] ^ mask[i]);
-        o->s3[i] = a->s3[i] ^ b->s3[i];
+        o->s[0][i] = a->s[0][i] ^ (b->s[0][i] ^ mask[i]);
+        o->s[1][i] = a->s[1][i] ^ b->s[1][i];
+        o->s[2][i] = a->s[2][i] ^ (b->s[2][i] ^ mask[i]);
+        o->s[3][i] = a->s[3][i] ^ b->s[3][i];
     }
     for(int i = VEC_N_SIZE_64/2; i < VEC_N_SIZE_64; i++) {
-        o->s0[i] = a->s0[i] ^ b->s0[i];
-        o->s1[i] = (a->s1[i] ^ mask[i]) ^ b->s1[i];
-        o->s2[i] = a->s2[i] ^ b->s2[i];
-        o->s3[i] = (a->s3[i] ^ mask[i]) ^ b->s3[i];
+        o->s[0][i] = a->s[0][i] ^ b->s[0][i];
+        o->s[1][i] = (a->s[1][i] ^ mask[i]) ^ b->s[1][i];
+        o->s[2][i] = a->s[2][i] ^ b->s[2][i];
+        o->s[3][i] = (a->s[3][i] ^ mask[i]) ^ b->s[3][i];
+    }
+#else
+    const unsigned masks = shares_masks();
+
+    for(unsigned j = 0; j < masks; j++)
+        for(int i = 0; i < VEC_N_SIZE_64; i++)
+            o->s[j][i] = a->s[j][i] ^ b->s[j][i];
+    if (masks == 1)
+        return;
+    shares_mask_dense(mask);
+
+    // the two pairs of masked shares of each half, as in the unrolled versions
+    const unsigned lo_i = 0, lo_j = masks > 2 ? 2 : 1;
+    const unsigned hi_i = masks > 3 ? 1 : 0, hi_j = masks > 3 ? 3 : 1;
+    for(int i = 0; i < VEC_N_SIZE_64/2; i++) {
+        o->s[lo_i][i] ^= mask[i];
+        o->s[lo_j][i] ^= mask[i];
+    }
+    for(int i = VEC_N_SIZE_64/2; i < VEC_N_SIZE_64; i++) {
+        o->s[hi_i][i] ^= mask[i];
+        o->s[hi_j][i] ^= mask[i];
     }
 #endif
 }
+
+
+/**
+ * @brief Offset in a chunk of words of a position of the vector, clamped to the chunk
+ */
+static inline size_t chunk_offset(size_t pos, size_t first, size_t n) {
+    return pos <= first ? 0 : pos - first < n ? pos - first : n;
+}
+
+
+/**
+ * @brief Adds a vector split as by shares_resize, an unshared vector and a shared vector, then adds the shares of
+ * the sum, in a single pass
+ *
+ * The result is the one of shares_resize, shares_add and shares_reduce, but the shares of the sum are never
+ * written. The vectors are processed REFRESH_CHUNK words at a time: the shares of a chunk are folded into the result
+ * one after the other, the mask of shares_add, drawn inline from mask_rng, entering with the first share of each
+ * pair and leaving with the second, so that the partial sums stay masked as in shares_reduce.
+ *
+ * @param[out] o Pointer to the result, count words, may be a, e or b->s[0]
+ * @param[in] a Pointer to the vector split in shares, VEC_N1N2_SIZE_64 words, or NULL
+ * @param[in] e Pointer to the vector added to share 0, count words, or NULL
+ * @param[in] b Pointer to the shares
+ * @param[in] count Number of words of the result, at most VEC_N_SIZE_64
+ */
+void shares_add_reduce(uint64_t *o, const uint64_t *a, const uint64_t *e, const shares_t *b, size_t count) {
+    const size_t masks = shares_masks();
+    const size_t part = VEC_N1N2_SIZE_64 / masks;
+    const size_t half = VEC_N_SIZE_64 / 2;
+    // the pairs of shares that get the mask in each half, as in shares_add
+    const size_t pair[2][2] = {{0, masks > 2 ? 2 : 1}, {masks > 3 ? 1 : 0, masks > 3 ? 3 : 1}};
+    uint64_t mask[REFRESH_CHUNK];
+    uint64_t sum[REFRESH_CHUNK];
+
+    for (size_t first = 0; first < count; first += REFRESH_CHUNK) {
+        const size_t n = count - first < REFRESH_CHUNK ? count - first : REFRESH_CHUNK;
+        const size_t mid = chunk_offset(half, first, n);
+
+        if (masks > 1) {
+            mask_rng((uint8_t *)mask, n * sizeof(uint64_t));
+        }
+        if (e != NULL) {
+            for (size_t p = 0; p < n; p++) {
+                sum[p] = b->s[0][first + p] ^ e[first + p];
+            }
+        } else {
+            memcpy(sum, b->s[0] + first, n * sizeof(uint64_t));
+        }
+
+        for (size_t j = 0; j < masks; j++) {
+            const uint64_t *s = b->s[j] + first;
+
+            for (size_t p = 0; j > 0 && p < n; p++) {
+                sum[p] ^= s[p];
+            }
+            // the words of a that shares_resize puts in share j
+            if (a != NULL) {
+                const size_t lo = chunk_offset(part * j, first, n);
+                const size_t hi = chunk_offset(j < masks - 1 ? part * (j + 1) : VEC_N1N2_SIZE_64, first, n);
+
+                for (size_t p = lo; p < hi; p++) {
+                    sum[p] ^= a[first + p];
+                }
+            }
+            if (masks > 1 && (j == pair[0][0] || j == pair[0][1])) {
+                for (size_t p = 0; p < mid; p++) {
+                    sum[p] ^= mask[p];
+                }
+            }
+            if (masks > 1 && (j == pair[1][0] || j == pair[1][1])) {
+                for (size_t p = mid; p < n; p++) {
+                    sum[p] ^= mask[p];
+                }
+            }
+        }
+        memcpy(o + first, sum, n * sizeof(uint64_t));
+    }
+    memset(mask, 0x00, sizeof(mask));
+    memset(sum, 0x00, sizeof(sum));
+}
+
+
+/**
+ * @brief Selects the instruction set of the rejection kernel of the fixed-weight mask sampler
+ *
+ * With SHARES_ISA_AUTO the widest one supported by the CPU is used. The kernel is published with a single store:
+ * the batches sampled meanwhile finish with the one they started with.
+ *
+ * @param[in] isa The requested instruction set
+ * @returns the instruction set actually selected
+ */
+shares_isa_t shares_set_isa(shares_isa_t isa) {
+    const shares_kernels_t *kernels = shares_pick(isa);
+
+    SHARES_STORE(shares_kernels, kernels);
+    return kernels->isa;
+}
@@ -5,53 +5,95 @@
 
 #pragma once
 
+/**
+ * Number of shares of the masking scheme. MASK_LVL from 1 to 4 fixes it at build time and selects the unrolled
+ * kernels; MASK_LVL = 0 builds the loop-based kernels only, with the number of shares chosen at run time with
+ * shares_set_masks, from 1 to MASKS_MAX.
+ */
 #define MASKS (MASK_LVL)
 
+#if MASKS == 0
+    #define MASKS_MAX 8
+#elif MASKS >= 1 && MASKS <= 4
+    #define MASKS_MAX MASKS
+#else
+#error TOO_MANY_SHARES
+#endif
 
-#if MASKS == 1
-    typedef struct shares_t {
-        uint64_t s0[VEC_N_SIZE_64];
-    } shares_t;
-#elif MASKS == 2
-    typedef struct {
-        uint64_t s0[VEC_N_SIZE_64];
-        uint64_t s1[VEC_N_SIZE_64];
-    } shares_t;
-#elif MASKS == 3
+/**
+ * Shares of a polynomial, s[i] being the share i; with MASK_LVL = 0 only the first shares_masks() are used
+ */
 typedef struct shares_t {
-        uint64_t s0[VEC_N_SIZE_64];
-        uint64_t s1[VEC_N_SIZE_64];
-        uint64_t s2[VEC_N_SIZE_64];
-    } shares_t;
-#elif MASKS == 4
-    typedef struct shares_t {
-        uint64_t s0[VEC_N_SIZE_64];
-        uint64_t s1[VEC_N_SIZE_64];
-        uint64_t s2[VEC_N_SIZE_64];
-        uint64_t s3[VEC_N_SIZE_64];
-    } shares_t;
+    uint64_t s[MASKS_MAX][VEC_N_SIZE_64];
+} shares_t;
+
+/**
+ * Instruction sets available for the rejection kernel of the fixed-weight mask sampler
+ */
+typedef enum {
+    SHARES_ISA_AUTO = 0,
+    SHARES_ISA_SCALAR,
+    SHARES_ISA_AVX512
+} shares_isa_t;
+
+/**
+ * Masks of the cross terms of safe_mul
+ */
+typedef enum {
+    SHARES_REFRESH_FIXED_WEIGHT = 0,
+    SHARES_REFRESH_DENSE
+} shares_refresh_t;
+
+extern unsigned shares_masks_runtime;
+
+/**
+ * @brief Number of shares of the masked routines: MASKS, a constant, in the builds with a fixed number of shares
+ */
+static inline unsigned shares_masks(void) {
+#if MASKS == 0
+    return shares_masks_runtime;
 #else
-#error TOO_MANY_SHARES
+    return MASKS;
 #endif
+}
+
+unsigned shares_set_masks(unsigned masks);
+
+void shares_mask_dense(uint64_t *mask);
+
+void shares_mask_cross_term(uint64_t *s, uint16_t weight);
+
+shares_refresh_t shares_set_refresh(shares_refresh_t refresh);
 
 void shares_resize(shares_t *shares, const uint64_t *in);
 
 void shares_add(shares_t *o, shares_t *a, shares_t *b);
 
+void shares_add_reduce(uint64_t *o, const uint64_t *a, const uint64_t *e, const shares_t *b, size_t count);
+
+shares_isa_t shares_set_isa(shares_isa_t isa);
+
 static inline void shares_init(shares_t *x) {
-    memset(x, 0x00, VEC_N_SIZE_BYTES * MASKS);
+    memset(x, 0x00, shares_masks() * sizeof(x->s[0]));
 }
 static inline void shares_reduce(uint64_t *o, shares_t *shares) {
 #if MASKS == 1
-    memcpy(o, shares->s0, VEC_N_SIZE_BYTES);
+    memcpy(o, shares->s[0], VEC_N_SIZE_BYTES);
 #elif MASKS == 2
     for(int i = 0; i < VEC_N_SIZE_64; i++)
-        o[i] = shares->s0[i] ^ shares->s1[i];
+        o[i] = shares->s[0][i] ^ shares->s[1][i];
 #elif MASKS == 3
     for(int i = 0; i < VEC_N_SIZE_64; i++)
-        o[i] = shares->s0[i] ^ shares->s1[i] ^ shares->s2[i];
+        o[i] = shares->s[0][i] ^ shares->s[1][i] ^ shares->s[2][i];
 #elif MASKS == 4
     for(int i = 0; i < VEC_N_SIZE_64; i++)
-        o[i] = shares->s0[i] ^ shares->s1[i] ^ shares->s2[i] ^ shares->s3[i];
+        o[i] = shares->s[0][i] ^ shares->s[1][i] ^ shares->s[2][i] ^ shares->s[3][i];
+#else
+    const unsigned masks = shares_masks();
+
+    memmove(o, shares->s[0], VEC_N_SIZE_BYTES);
+    for(unsigned j = 1; j < masks; j++)
+        for(int i = 0; i < VEC_N_SIZE_64; i++)
+            o[i] ^= shares->s[j][i];
 #endif
 }
@@ -0,0 +1,45 @@
+/**
+ * @file shares_simd.c
+ * @brief AVX-512 kernel of the fixed-weight mask sampler of shares.c
+ *
+ * It is compiled with a per-function target attribute, so that the dispatcher in shares.c can pick it at runtime
+ * depending on the features of the CPU.
+ */
+
+#include <stdint.h>
+
+#include "shares_simd.h"
+
+#ifdef SHARES_X86_SIMD
+#include <immintrin.h>
+
+/**
+ * @brief Rejection step of the fixed-weight mask sampler, 16 words at a time (512-bit lanes): the words below
+ * threshold are reduced modulo modulus with conditional subtractions and packed at the start of out
+ *
+ * @param[out] out Pointer to the accepted values, n words
+ * @param[in] in Pointer to the 16-bit words
+ * @param[in] n Number of words, a multiple of 16
+ * @param[in] modulus Modulus of the reduction
+ * @param[in] threshold Rejection threshold, a multiple of modulus no larger than 2^16
+ * @returns the number of accepted values
+ */
+__attribute__((target("avx512f")))
+size_t shares_mask_candidates_avx512(uint32_t *out, const uint16_t *in, size_t n, uint32_t modulus, uint32_t threshold) {
+    const __m512i q = _mm512_set1_epi32((int) modulus);
+    const __m512i t = _mm512_set1_epi32((int) threshold);
+    size_t k = 0;
+
+    for (size_t i = 0; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) (in + i)));
+        const __mmask16 keep = _mm512_cmplt_epu32_mask(x, t);
+
+        for (uint32_t r = modulus; r < threshold; r += modulus) {
+            x = _mm512_mask_sub_epi32(x, _mm512_cmpge_epu32_mask(x, q), x, q);
+        }
+        _mm512_mask_compressstoreu_epi32(out + k, keep, x);
+        k += (size_t) __builtin_popcount(keep);
+    }
+    return k;
+}
+#endif
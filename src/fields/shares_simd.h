@@ -0,0 +1,20 @@
+#ifndef SHARES_SIMD_H
+#define SHARES_SIMD_H
+
+/**
+ * @file shares_simd.h
+ * @brief Header file for shares_simd.c
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define SHARES_X86_SIMD
+#endif
+
+#ifdef SHARES_X86_SIMD
+size_t shares_mask_candidates_avx512(uint32_t *out, const uint16_t *in, size_t n, uint32_t modulus, uint32_t threshold);
+#endif
+
+#endif
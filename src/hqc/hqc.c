@@ -27,8 +27,9 @@
  *
  * @param[out] pk String containing the public key
  * @param[out] sk String containing the secret key
+ * @param[in,out] rng Pointer to the context the seeds are drawn from
  */
-void hqc_pke_keygen(unsigned char* pk, unsigned char* sk) {
+void hqc_pke_keygen(unsigned char* pk, unsigned char* sk, hqc_rng *rng) {
     seedexpander_state sk_seedexpander;
     seedexpander_state pk_seedexpander;
     uint8_t sk_seed[SEED_BYTES] = {0};
@@ -38,12 +39,13 @@ void hqc_pke_keygen(unsigned char* pk, unsigned char* sk) {
     uint64_t h[VEC_N_SIZE_64] = {0};
     uint64_t s[VEC_N_SIZE_64] = {0};
 
-    // Create seed_expanders for public key and secret key
-    shake_prng(sk_seed, SEED_BYTES);
-    seedexpander_init(&sk_seedexpander, sk_seed, SEED_BYTES);
+    seedexpander_state *seedexpanders[4] = {&sk_seedexpander, &pk_seedexpander, NULL, NULL};
+    const uint8_t *seeds[4] = {sk_seed, pk_seed, NULL, NULL};
 
-    shake_prng(pk_seed, SEED_BYTES);
-    seedexpander_init(&pk_seedexpander, pk_seed, SEED_BYTES);
+    // Create seed_expanders for public key and secret key, side by side
+    hqc_rng_bytes(rng, sk_seed, SEED_BYTES);
+    hqc_rng_bytes(rng, pk_seed, SEED_BYTES);
+    seedexpander_init_x4(seedexpanders, seeds, SEED_BYTES);
 
     // Compute secret key
     vect_set_random_fixed_weight(&sk_seedexpander, x, PARAM_OMEGA);
@@ -84,8 +86,11 @@ void hqc_pke_keygen(unsigned char* pk, unsigned char* sk) {
  * @param[in] m Vector representing the message to encrypt
  * @param[in] theta Seed used to derive randomness required for encryption
  * @param[in] pk String containing the public key
+ * @param[in,out] rng Pointer to the context the masks are drawn from
  */
-void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta, const unsigned char *pk) {
+void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta, const unsigned char *pk,
+                     hqc_rng *rng) {
+    hqc_rng *const bound = hqc_rng_bind(rng);
     seedexpander_state seedexpander;
     uint64_t h[VEC_N_SIZE_64] = {0};
     uint64_t s[VEC_N_SIZE_64] = {0};
@@ -93,10 +98,7 @@ void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta
     uint32_t r2[PARAM_OMEGA_R] = {0};
     uint64_t e[VEC_N_SIZE_64] = {0};
 
-    shares_t tmp1;
     shares_t tmp2;
-    shares_init(&tmp1);
-    shares_init(&tmp2);
 
 
     // Create seed_expander from theta
@@ -117,16 +119,14 @@ void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta
 
     // Compute v = m.G by encoding the message
     code_encode(v, m);
-    shares_resize(&tmp1, v);
 
-    // Compute v = m.G + s.r2 + e
+    // Compute v = m.G + s.r2 + e, truncated to PARAM_N1N2 bits, in a single pass past the multiplication
     safe_mul(&tmp2, r2, s, PARAM_OMEGA_R);
-    shares_add(&tmp2, &tmp1, &tmp2);
-    vect_add(tmp2.s0, e, tmp2.s0, VEC_N_SIZE_64);
-
-
-    shares_reduce(tmp2.s0, &tmp2);
-    vect_resize(v, PARAM_N1N2, tmp2.s0, PARAM_N);
+    shares_add_reduce(v, v, e, &tmp2, VEC_N1N2_SIZE_64);
+#if PARAM_N1N2 % 64
+    v[VEC_N1N2_SIZE_64 - 1] &= BITMASK(PARAM_N1N2, 64);
+#endif
+    hqc_rng_bind(bound);
     #ifdef VERBOSE
         printf("\n\nh: "); vect_print(h, VEC_N_SIZE_BYTES);
         printf("\n\ns: "); vect_print(s, VEC_N_SIZE_BYTES);
@@ -149,28 +149,22 @@ void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta
  * @param[in] u Vector u (first part of the ciphertext)
  * @param[in] v Vector v (second part of the ciphertext)
  * @param[in] sk String containing the secret key
+ * @param[in,out] rng Pointer to the context the masks are drawn from
  */
 
-void hqc_pke_decrypt(uint64_t *m, const uint64_t *u, const uint64_t *v, const unsigned char *sk) {
+void hqc_pke_decrypt(uint64_t *m, const uint64_t *u, const uint64_t *v, const unsigned char *sk, hqc_rng *rng) {
+    hqc_rng *const bound = hqc_rng_bind(rng);
     uint64_t x[VEC_N_SIZE_64] = {0};
     uint32_t y[PARAM_OMEGA] = {0};
-    uint8_t pk[PUBLIC_KEY_BYTES] = {0};
-    shares_t tmp1;
     shares_t tmp2;
-    shares_init(&tmp1);
-    shares_init(&tmp2);
 
-    // Retrieve x, y, pk from secret key
-    hqc_secret_key_from_string(x, y, pk, sk);
+    // Retrieve x and y from secret key, the public key is not needed
+    hqc_secret_key_from_string(x, y, NULL, sk);
 
-    // Compute v - u.y
-    shares_resize(&tmp1, v);
+    // Compute v - u.y and remove the mask, in a single pass past the multiplication
     safe_mul(&tmp2, y, u, PARAM_OMEGA);
-    shares_add(&tmp2, &tmp1, &tmp2);
-
-
-    // remove the mask2
-    shares_reduce(tmp2.s0, &tmp2);
+    shares_add_reduce(tmp2.s[0], v, NULL, &tmp2, VEC_N_SIZE_64);
+    hqc_rng_bind(bound);
 
 
 #ifdef VERBOSE
@@ -181,5 +175,5 @@ void hqc_pke_decrypt(uint64_t *m, const uint64_t *u, const uint64_t *v, const un
     #endif
 
     // Compute m by decoding v - u.y
-    code_decode(m, tmp2.s0);
+    code_decode(m, tmp2.s[0]);
 }
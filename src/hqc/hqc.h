@@ -8,8 +8,11 @@
 
 #include <stdint.h>
 
-void hqc_pke_keygen(unsigned char* pk, unsigned char* sk);
-void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta, const unsigned char *pk);
-void hqc_pke_decrypt(uint64_t *m, const uint64_t *u, const uint64_t *v, const unsigned char *sk);
+#include "../lib/hqc_rng.h"
+
+void hqc_pke_keygen(unsigned char* pk, unsigned char* sk, hqc_rng *rng);
+void hqc_pke_encrypt(uint64_t *u, uint64_t *v, uint64_t *m, unsigned char *theta, const unsigned char *pk,
+                     hqc_rng *rng);
+void hqc_pke_decrypt(uint64_t *m, const uint64_t *u, const uint64_t *v, const unsigned char *sk, hqc_rng *rng);
 
 #endif
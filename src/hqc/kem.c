@@ -4,12 +4,12 @@
  */
 
 #include <stdint.h>
-#include <string.h>
 
 #include "../common/api.h"
 #include "../common/parameters.h"
 #include "../common/parsing.h"
 #include "../common/vector.h"
+#include "../lib/hqc_rng.h"
 #include "../lib/shake_ds.h"
 #include "hqc.h"
 
@@ -18,6 +18,45 @@
 #endif
 
 
+/**
+ * @brief Computes the G and H hashes of a message side by side, with the permutations of a 2-lane state
+ *
+ * @param[out] theta G hash of the message, the seed of the encryption
+ * @param[out] d H hash of the message
+ * @param[in] m Message
+ */
+static void hash_g_h(uint8_t *theta, uint8_t *d, const uint64_t *m) {
+    uint8_t *output[2] = {theta, d};
+    const uint8_t *input[2] = {(const uint8_t *) m, (const uint8_t *) m};
+    const uint8_t domain[2] = {G_FCT_DOMAIN, H_FCT_DOMAIN};
+
+    shake256_512_ds_x2(output, input, VEC_K_SIZE_BYTES, domain);
+}
+
+
+
+/**
+ * @brief Computes the K hash of a message and a ciphertext, absorbing m, u and v from their own buffers
+ *
+ * @param[out] ss Shared secret
+ * @param[in] m Message
+ * @param[in] u String containing the vector u
+ * @param[in] v String containing the vector v
+ */
+static void hash_k(uint8_t *ss, const uint64_t *m, const uint8_t *u, const uint8_t *v) {
+    const uint8_t domain = K_FCT_DOMAIN;
+    shake256incctx shake256state;
+
+    shake256_inc_init(&shake256state);
+    shake256_inc_absorb(&shake256state, (const uint8_t *) m, VEC_K_SIZE_BYTES);
+    shake256_inc_absorb(&shake256state, u, VEC_N_SIZE_BYTES);
+    shake256_inc_absorb(&shake256state, v, VEC_N1N2_SIZE_BYTES);
+    shake256_inc_absorb(&shake256state, &domain, 1);
+    shake256_inc_finalize(&shake256state);
+    shake256_inc_squeeze(ss, SHAKE256_512_BYTES, &shake256state);
+}
+
+
 /**
  * @brief Keygen of the HQC_KEM IND_CAA2 scheme
  *
@@ -28,14 +67,32 @@
  *
  * @param[out] pk String containing the public key
  * @param[out] sk String containing the secret key
- * @returns 0 if keygen is successful
+ * @returns 0 if keygen is successful, -1 if the default context cannot generate random bytes
  */
 int crypto_kem_keypair(unsigned char *pk, unsigned char *sk) {
+    return crypto_kem_keypair_rng(pk, sk, hqc_rng_default());
+}
+
+
+
+/**
+ * @brief Keygen of the HQC_KEM IND_CAA2 scheme, with the random bytes of a context
+ *
+ * @param[out] pk String containing the public key
+ * @param[out] sk String containing the secret key
+ * @param[in,out] rng Pointer to the context
+ * @returns 0 if keygen is successful, -1 if the context cannot generate random bytes, pk and sk then left untouched
+ */
+int crypto_kem_keypair_rng(unsigned char *pk, unsigned char *sk, hqc_rng *rng) {
     #ifdef VERBOSE
         printf("\n\n\n\n### KEYGEN ###");
     #endif
 
-    hqc_pke_keygen(pk, sk);
+    if (hqc_rng_status(rng) != 0) {
+        return -1;
+    }
+
+    hqc_pke_keygen(pk, sk, rng);
     return 0;
 }
 
@@ -47,9 +104,25 @@ int crypto_kem_keypair(unsigned char *pk, unsigned char *sk) {
  * @param[out] ct String containing the ciphertext
  * @param[out] ss String containing the shared secret
  * @param[in] pk String containing the public key
- * @returns 0 if encapsulation is successful
+ * @returns 0 if encapsulation is successful, -1 if the default context cannot generate random bytes
  */
 int crypto_kem_enc(unsigned char *ct, unsigned char *ss, const unsigned char *pk) {
+    return crypto_kem_enc_rng(ct, ss, pk, hqc_rng_default());
+}
+
+
+
+/**
+ * @brief Encapsulation of the HQC_KEM IND_CAA2 scheme, with the random bytes and masks of a context
+ *
+ * @param[out] ct String containing the ciphertext
+ * @param[out] ss String containing the shared secret
+ * @param[in] pk String containing the public key
+ * @param[in,out] rng Pointer to the context
+ * @returns 0 if encapsulation is successful, -1 if the context cannot generate random bytes, ct and ss then left
+ * untouched
+ */
+int crypto_kem_enc_rng(unsigned char *ct, unsigned char *ss, const unsigned char *pk, hqc_rng *rng) {
     #ifdef VERBOSE
         printf("\n\n\n\n### ENCAPS ###");
     #endif
@@ -59,26 +132,22 @@ int crypto_kem_enc(unsigned char *ct, unsigned char *ss, const unsigned char *pk
     uint64_t u[VEC_N_SIZE_64] = {0};
     uint64_t v[VEC_N1N2_SIZE_64] = {0};
     uint8_t d[SHAKE256_512_BYTES] = {0};
-    uint8_t mc[VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES] = {0};
-    shake256incctx shake256state;
+
+    if (hqc_rng_status(rng) != 0) {
+        return -1;
+    }
 
     // Computing m
-    vect_set_random_from_prng(m);
+    vect_set_random_from_prng(rng, m);
 
-    // Computing theta
-    shake256_512_ds(&shake256state, theta, (uint8_t*) m, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
+    // Computing theta and d
+    hash_g_h(theta, d, m);
 
     // Encrypting m
-    hqc_pke_encrypt(u, v, m, theta, pk);
-
-    // Computing d
-    shake256_512_ds(&shake256state, d, (uint8_t *) m, VEC_K_SIZE_BYTES, H_FCT_DOMAIN);
+    hqc_pke_encrypt(u, v, m, theta, pk, rng);
 
     // Computing shared secret
-    memcpy(mc, m, VEC_K_SIZE_BYTES);
-    memcpy(mc + VEC_K_SIZE_BYTES, u, VEC_N_SIZE_BYTES);
-    memcpy(mc + VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES, v, VEC_N1N2_SIZE_BYTES);
-    shake256_512_ds(&shake256state, ss, mc, VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES, K_FCT_DOMAIN);
+    hash_k(ss, m, (uint8_t *) u, (uint8_t *) v);
 
     // Computing ciphertext
     hqc_ciphertext_to_string(ct, u, v, d);
@@ -102,7 +171,7 @@ int crypto_kem_enc(unsigned char *ct, unsigned char *ss, const unsigned char *pk
  * @param[out] ct String containing the ciphertext
  * @param[out] ss String containing the shared secret
  * @param[in] pk String containing the public key
- * @returns 0 if encapsulation is successful
+ * @returns 0 if encapsulation is successful, -1 if the default context cannot generate its masks
  */
 int crypto_kem_enc_const(unsigned char *ct, unsigned char *ss, const unsigned char *pk) {
 #ifdef VERBOSE
@@ -114,28 +183,24 @@ int crypto_kem_enc_const(unsigned char *ct, unsigned char *ss, const unsigned ch
     uint64_t u[VEC_N_SIZE_64] = {0};
     uint64_t v[VEC_N1N2_SIZE_64] = {0};
     uint8_t d[SHAKE256_512_BYTES] = {0};
-    uint8_t mc[VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES] = {0};
-    shake256incctx shake256state;
+
+    if (hqc_rng_status(hqc_rng_default()) != 0) {
+        return -1;
+    }
 
     // Computing m
     for(int i = 0; i < VEC_K_SIZE_64; i++)
         m[i] = 0x5555555555555555;
 
 
-    // Computing theta
-    shake256_512_ds(&shake256state, theta, (uint8_t*) m, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
+    // Computing theta and d
+    hash_g_h(theta, d, m);
 
     // Encrypting m
-    hqc_pke_encrypt(u, v, m, theta, pk);
-
-    // Computing d
-    shake256_512_ds(&shake256state, d, (uint8_t *) m, VEC_K_SIZE_BYTES, H_FCT_DOMAIN);
+    hqc_pke_encrypt(u, v, m, theta, pk, hqc_rng_default());
 
     // Computing shared secret
-    memcpy(mc, m, VEC_K_SIZE_BYTES);
-    memcpy(mc + VEC_K_SIZE_BYTES, u, VEC_N_SIZE_BYTES);
-    memcpy(mc + VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES, v, VEC_N1N2_SIZE_BYTES);
-    shake256_512_ds(&shake256state, ss, mc, VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES, K_FCT_DOMAIN);
+    hash_k(ss, m, (uint8_t *) u, (uint8_t *) v);
 
     // Computing ciphertext
     hqc_ciphertext_to_string(ct, u, v, d);
@@ -161,9 +226,25 @@ int crypto_kem_enc_const(unsigned char *ct, unsigned char *ss, const unsigned ch
  * @param[out] ss String containing the shared secret
  * @param[in] ct String containing the cipĥertext
  * @param[in] sk String containing the secret key
- * @returns 0 if decapsulation is successful, -1 otherwise
+ * @returns 0 if decapsulation is successful, -1 otherwise, as when the default context cannot generate the masks
  */
 int crypto_kem_dec(unsigned char *ss, const unsigned char *ct, const unsigned char *sk) {
+    return crypto_kem_dec_rng(ss, ct, sk, hqc_rng_default());
+}
+
+
+
+/**
+ * @brief Decapsulation of the HQC_KEM IND_CAA2 scheme, with the masks of a context
+ *
+ * @param[out] ss String containing the shared secret
+ * @param[in] ct String containing the cipĥertext
+ * @param[in] sk String containing the secret key
+ * @param[in,out] rng Pointer to the context
+ * @returns 0 if decapsulation is successful, -1 otherwise, as when the context cannot generate the masks, ss then
+ * left untouched
+ */
+int crypto_kem_dec_rng(unsigned char *ss, const unsigned char *ct, const unsigned char *sk, hqc_rng *rng) {
     #ifdef VERBOSE
         printf("\n\n\n\n### DECAPS ###");
     #endif
@@ -171,44 +252,38 @@ int crypto_kem_dec(unsigned char *ss, const unsigned char *ct, const unsigned ch
     uint8_t result;
     uint64_t u[VEC_N_SIZE_64] = {0};
     uint64_t v[VEC_N1N2_SIZE_64] = {0};
-    uint8_t d[SHAKE256_512_BYTES] = {0};
-    uint8_t pk[PUBLIC_KEY_BYTES] = {0};
     uint64_t m[VEC_K_SIZE_64] = {0};
     uint8_t theta[SHAKE256_512_BYTES] = {0};
-    uint64_t u2[VEC_N_SIZE_64] = {0};
-    uint64_t v2[VEC_N1N2_SIZE_64] = {0};
     uint8_t d2[SHAKE256_512_BYTES] = {0};
-    uint8_t mc[VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES] = {0};
-    shake256incctx shake256state;
-
-    // Retrieving u, v and d from ciphertext
-    hqc_ciphertext_from_string(u, v , d, ct);
+    // the K hash and the comparison read u, v and d in place from the ciphertext, the re-encryption pk from sk
+    const uint8_t *ct_u = ct;
+    const uint8_t *ct_v = ct + VEC_N_SIZE_BYTES;
+    const uint8_t *ct_d = ct + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES;
+    const uint8_t *pk = sk + SEED_BYTES;
+
+    if (hqc_rng_status(rng) != 0) {
+        return -1;
+    }
 
-    // Retrieving pk from sk
-    memcpy(pk, sk + SEED_BYTES, PUBLIC_KEY_BYTES);
+    // Copying u and v from the ciphertext into whole 64-bit words for the decryption: v is not 8-byte aligned there
+    hqc_ciphertext_from_string(u, v, NULL, ct);
 
     // Decryting
-    hqc_pke_decrypt(m, u, v, sk);
-
-    // Computing theta
-    shake256_512_ds(&shake256state, theta, (uint8_t*) m, VEC_K_SIZE_BYTES, G_FCT_DOMAIN);
+    hqc_pke_decrypt(m, u, v, sk, rng);
 
-    // Encrypting m'
-    hqc_pke_encrypt(u2, v2, m, theta, pk);
+    // Computing theta and d'
+    hash_g_h(theta, d2, m);
 
-    // Computing d'
-    shake256_512_ds(&shake256state, d2, (uint8_t *) m, VEC_K_SIZE_BYTES, H_FCT_DOMAIN);
+    // Encrypting m', u' and v' in place of u and v
+    hqc_pke_encrypt(u, v, m, theta, pk, rng);
 
     // Computing shared secret
-    memcpy(mc, m, VEC_K_SIZE_BYTES);
-    memcpy(mc + VEC_K_SIZE_BYTES, u, VEC_N_SIZE_BYTES);
-    memcpy(mc + VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES, v, VEC_N1N2_SIZE_BYTES);
-    shake256_512_ds(&shake256state, ss, mc, VEC_K_SIZE_BYTES + VEC_N_SIZE_BYTES + VEC_N1N2_SIZE_BYTES, K_FCT_DOMAIN);
+    hash_k(ss, m, ct_u, ct_v);
 
     // Abort if c != c' or d != d'
-    result = vect_compare((uint8_t *)u, (uint8_t *)u2, VEC_N_SIZE_BYTES);
-    result |= vect_compare((uint8_t *)v, (uint8_t *)v2, VEC_N1N2_SIZE_BYTES);
-    result |= vect_compare(d, d2, SHAKE256_512_BYTES);
+    result = vect_compare(ct_u, (uint8_t *)u, VEC_N_SIZE_BYTES);
+    result |= vect_compare(ct_v, (uint8_t *)v, VEC_N1N2_SIZE_BYTES);
+    result |= vect_compare(ct_d, d2, SHAKE256_512_BYTES);
 
     result = (uint8_t) (-((int16_t) result) >> 15);
 
@@ -223,8 +298,8 @@ int crypto_kem_dec(unsigned char *ss, const unsigned char *ct, const unsigned ch
         printf("\n\nm: "); vect_print(m, VEC_K_SIZE_BYTES);
         printf("\n\ntheta: "); for(int i = 0 ; i < SHAKE256_512_BYTES ; ++i) printf("%02x", theta[i]);
         printf("\n\n\n# Checking Ciphertext- Begin #");
-        printf("\n\nu2: "); vect_print(u2, VEC_N_SIZE_BYTES);
-        printf("\n\nv2: "); vect_print(v2, VEC_N1N2_SIZE_BYTES);
+        printf("\n\nu2: "); vect_print(u, VEC_N_SIZE_BYTES);
+        printf("\n\nv2: "); vect_print(v, VEC_N1N2_SIZE_BYTES);
         printf("\n\nd2: "); for(int i = 0 ; i < SHAKE256_512_BYTES ; ++i) printf("%02x", d2[i]);
         printf("\n\n# Checking Ciphertext - End #\n");
     #endif
@@ -12,5 +12,10 @@
 #define G_FCT_DOMAIN 3
 #define H_FCT_DOMAIN 4
 #define K_FCT_DOMAIN 5
+#define MASK_RNG_DOMAIN 6
+#define MASK_POOL_DOMAIN 7
+#define PRNG_FORK_DOMAIN 8
+#define DRBG_DOMAIN 9
+#define DRBG_SEED_DOMAIN 10
 
 #endif
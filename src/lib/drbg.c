@@ -0,0 +1,220 @@
+/**
+ * @file drbg.c
+ * @brief DRBG seeded from an entropy source, for the random bytes of production use
+ *
+ * The bytes are generated in bulk, DRBG_BUFFER_BYTES at a time, by 8 SHAKE-256 streams of the key, squeezed side by
+ * side with the multi-lane permutation of fips202x4.c: lane j absorbs the key, the DRBG_DOMAIN domain and j, and
+ * squeezes an eighth of the refill then an eighth of the next key. Small requests are served from the buffer, whole
+ * refills of large ones straight into the output. Every DRBG_RESEED_INTERVAL refills, the key is derived anew from
+ * itself and DRBG_SEED_BYTES bytes of the entropy source, in the DRBG_SEED_DOMAIN domain.
+ * A DRBG whose entropy source has never worked generates nothing: its key would only be as unpredictable as the
+ * personalization string. Once seeded, a failed periodic reseed leaves the key as unpredictable as it was, and the
+ * bytes keep coming; the reseed is tried again DRBG_RESEED_INTERVAL refills later.
+ * By default the entropy source is the one of the operating system, getrandom(2) on Linux and getentropy(3) on the
+ * BSDs and macOS. There is none on the board, whose builds define DRBG_DISABLED and leave the DRBG out.
+ */
+
+#include <string.h>
+
+#include "drbg.h"
+#include "domains.h"
+#include "fips202.h"
+#include "fips202x4.h"
+
+#ifndef DRBG_DISABLED
+
+#if !defined(CROSSCOMPILE) && defined(__linux__)
+    #include <errno.h>
+    #include <sys/random.h>
+#elif !defined(CROSSCOMPILE) && (defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__))
+    #include <unistd.h>
+#endif
+
+
+/**
+ * @brief Entropy source of the operating system
+ *
+ * @param[out] output Pointer to the output
+ * @param[in] outlen Number of bytes
+ * @returns 0, or -1 if the system has no source or it failed
+ */
+int drbg_entropy_system(uint8_t *output, size_t outlen) {
+#if !defined(CROSSCOMPILE) && defined(__linux__)
+    while (outlen > 0) {
+        const ssize_t n = getrandom(output, outlen, 0);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        output += n;
+        outlen -= (size_t) n;
+    }
+    return 0;
+#elif !defined(CROSSCOMPILE) && (defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__))
+    while (outlen > 0) {
+        const size_t n = outlen < 256 ? outlen : 256;
+
+        if (getentropy(output, n) != 0) {
+            return -1;
+        }
+        output += n;
+        outlen -= n;
+    }
+    return 0;
+#else
+    (void) output;
+    (void) outlen;
+    return -1;
+#endif
+}
+
+
+
+/**
+ * @brief Generates DRBG_BUFFER_BYTES bytes into output and replaces the key, reseeding first when it is due; the key
+ * of a seeded DRBG carries on if the reseed fails
+ */
+static void drbg_refill(drbg_state *drbg, uint8_t *output) {
+    uint8_t domain = DRBG_DOMAIN;
+    uint8_t index[8];
+    const uint8_t *keys[8], *domains[8], *indices[8];
+    uint8_t *outputs[8], *next[8];
+    shake256x8incctx state;
+
+    if (drbg->refills >= DRBG_RESEED_INTERVAL) {
+        drbg_reseed(drbg, NULL, 0);
+    }
+    for (size_t j = 0; j < 8; j++) {
+        index[j] = (uint8_t) j;
+        keys[j] = drbg->key;
+        domains[j] = &domain;
+        indices[j] = &index[j];
+        outputs[j] = output + j * (DRBG_BUFFER_BYTES / 8);
+        next[j] = drbg->key + j * (DRBG_KEY_BYTES / 8);
+    }
+    shake256x8_inc_init(&state);
+    shake256x8_inc_absorb(&state, keys, DRBG_KEY_BYTES);
+    shake256x8_inc_absorb(&state, domains, 1);
+    shake256x8_inc_absorb(&state, indices, 1);
+    shake256x8_inc_finalize(&state);
+    shake256x8_inc_squeeze(outputs, DRBG_BUFFER_BYTES / 8, &state);
+    shake256x8_inc_squeeze(next, DRBG_KEY_BYTES / 8, &state);
+    memset(&state, 0x00, sizeof(state));
+    drbg->refills++;
+}
+
+
+
+/**
+ * @brief Seeds a DRBG from its entropy source and a personalization string
+ *
+ * @param[out] drbg Pointer to the state
+ * @param[in] entropy Entropy source, drbg_entropy_system if NULL
+ * @param[in] personalization_string Pointer to the personalization string
+ * @param[in] perlen Length of the personalization string in bytes
+ * @returns 0, or -1 if the entropy source failed, in which case drbg_generate refuses to generate until a reseed
+ * gets its bytes
+ */
+int drbg_init(drbg_state *drbg, drbg_entropy_t entropy, const uint8_t *personalization_string, size_t perlen) {
+    memset(drbg, 0x00, sizeof(*drbg));
+    drbg->entropy = entropy != NULL ? entropy : drbg_entropy_system;
+    return drbg_reseed(drbg, personalization_string, perlen);
+}
+
+
+
+/**
+ * @brief Derives the key anew from itself, fresh bytes of the entropy source and an additional input; the bytes left
+ * in the buffer are discarded
+ *
+ * @param[in,out] drbg Pointer to the state
+ * @param[in] additional_input Pointer to the additional input
+ * @param[in] addlen Length of the additional input in bytes
+ * @returns 0, or -1 if the entropy source failed, in which case the key is derived without its bytes, and a DRBG
+ * that was not seeded yet stays so
+ */
+int drbg_reseed(drbg_state *drbg, const uint8_t *additional_input, size_t addlen) {
+    uint8_t domain = DRBG_SEED_DOMAIN;
+    uint8_t seed[DRBG_SEED_BYTES];
+    shake256incctx state;
+    int status = -1;
+
+    if (drbg->entropy != NULL) {
+        status = drbg->entropy(seed, DRBG_SEED_BYTES) == 0 ? 0 : -1;
+    }
+    if (status != 0) {
+        memset(seed, 0x00, DRBG_SEED_BYTES);
+    } else {
+        drbg->seeded = 1;
+    }
+    shake256_inc_init(&state);
+    shake256_inc_absorb(&state, drbg->key, DRBG_KEY_BYTES);
+    shake256_inc_absorb(&state, seed, DRBG_SEED_BYTES);
+    shake256_inc_absorb(&state, additional_input, addlen);
+    shake256_inc_absorb(&state, &domain, 1);
+    shake256_inc_finalize(&state);
+    shake256_inc_squeeze(drbg->key, DRBG_KEY_BYTES, &state);
+    memset(&state, 0x00, sizeof(state));
+    memset(seed, 0x00, DRBG_SEED_BYTES);
+
+    memset(drbg->buffer, 0x00, DRBG_BUFFER_BYTES);
+    drbg->left = 0;
+    drbg->refills = 0;
+    return status;
+}
+
+
+
+/**
+ * @brief Random bytes of a DRBG
+ *
+ * @param[in,out] drbg Pointer to the state
+ * @param[out] output Pointer to output
+ * @param[in] outlen length of output in bytes
+ * @returns 0, or -1 if the DRBG was never seeded from its entropy source, in which case nothing is written
+ */
+int drbg_generate(drbg_state *drbg, uint8_t *output, size_t outlen) {
+    if (!drbg->seeded) {
+        return -1;
+    }
+
+    while (outlen > 0) {
+        if (drbg->left == 0) {
+            // whole refills go straight to the output
+            if (outlen >= DRBG_BUFFER_BYTES) {
+                drbg_refill(drbg, output);
+                output += DRBG_BUFFER_BYTES;
+                outlen -= DRBG_BUFFER_BYTES;
+                continue;
+            }
+            drbg_refill(drbg, drbg->buffer);
+            drbg->left = DRBG_BUFFER_BYTES;
+        }
+
+        uint8_t *bytes = drbg->buffer + DRBG_BUFFER_BYTES - drbg->left;
+        const size_t n = outlen < drbg->left ? outlen : drbg->left;
+        memcpy(output, bytes, n);
+        // the bytes handed out are not kept in the buffer
+        memset(bytes, 0x00, n);
+        drbg->left -= n;
+        output += n;
+        outlen -= n;
+    }
+    return 0;
+}
+
+
+
+/**
+ * @brief Erases a DRBG
+ *
+ * @param[out] drbg Pointer to the state
+ */
+void drbg_clear(drbg_state *drbg) {
+    memset(drbg, 0x00, sizeof(*drbg));
+}
+
+#endif
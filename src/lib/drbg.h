@@ -0,0 +1,50 @@
+#ifndef DRBG_H
+#define DRBG_H
+
+/**
+ * @file drbg.h
+ * @brief Header file of drbg.c
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The board has no entropy source: its builds leave the DRBG out, and the contexts of hqc_rng.c without one
+#if defined(CROSSCOMPILE) && !defined(DRBG_DISABLED)
+    #define DRBG_DISABLED
+#endif
+
+#ifndef DRBG_BUFFER_BYTES
+    #define DRBG_BUFFER_BYTES 4096 /*!< Bytes generated by one refill, a multiple of 8 */
+#endif
+#ifndef DRBG_RESEED_INTERVAL
+    #define DRBG_RESEED_INTERVAL 1024 /*!< Refills between two reseeds from the entropy source */
+#endif
+#define DRBG_KEY_BYTES 64 /*!< Bytes of the key the refills are derived from, a multiple of 8 */
+#define DRBG_SEED_BYTES 48 /*!< Bytes drawn from the entropy source by a (re)seed */
+
+/**
+ * Source of entropy: fills output with outlen unpredictable bytes and returns 0, or returns -1 if it cannot
+ */
+typedef int (*drbg_entropy_t)(uint8_t *output, size_t outlen);
+
+/**
+ * State of a DRBG; the key is replaced at every refill, so that the state does not tell the bytes handed out before
+ */
+typedef struct {
+    uint8_t key[DRBG_KEY_BYTES]; /*!< Key of the next refill */
+    uint8_t buffer[DRBG_BUFFER_BYTES]; /*!< Bytes of the last refill, the ones handed out zeroed */
+    size_t left; /*!< Bytes of the buffer not handed out yet, at its end */
+    uint32_t refills; /*!< Refills since the last reseed */
+    drbg_entropy_t entropy; /*!< Source of the (re)seeds */
+    int seeded; /*!< 1 once a (re)seed got the bytes of the entropy source; until then no byte is generated */
+} drbg_state;
+
+int drbg_entropy_system(uint8_t *output, size_t outlen);
+
+int drbg_init(drbg_state *drbg, drbg_entropy_t entropy, const uint8_t *personalization_string, size_t perlen);
+int drbg_reseed(drbg_state *drbg, const uint8_t *additional_input, size_t addlen);
+int drbg_generate(drbg_state *drbg, uint8_t *output, size_t outlen);
+void drbg_clear(drbg_state *drbg);
+
+#endif
@@ -9,8 +9,10 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "fips202.h"
+#include "fips202_simd.h"
 
 #define NROUNDS 24
 #define ROL(a, offset) (((a) << (offset)) ^ ((a) >> (64 - (offset))))
@@ -64,13 +66,13 @@ static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
 };
 
 /*************************************************
- * Name:        KeccakF1600_StatePermute
+ * Name:        KeccakF1600_StatePermute_ref
  *
- * Description: The Keccak F1600 Permutation
+ * Description: The Keccak F1600 Permutation, scalar version
  *
  * Arguments:   - uint64_t *state: pointer to input/output Keccak state
  **************************************************/
-static void KeccakF1600_StatePermute(uint64_t *state) {
+static void KeccakF1600_StatePermute_ref(uint64_t *state) {
     int round;
 
     uint64_t Aba, Abe, Abi, Abo, Abu;
@@ -333,6 +335,36 @@ static void KeccakF1600_StatePermute(uint64_t *state) {
     state[24] = Asu;
 }
 
+#ifdef FIPS202_X86_SIMD
+static void (*KeccakF1600_StatePermute_impl)(uint64_t *state) = NULL;
+#endif
+
+/*************************************************
+ * Name:        KeccakF1600_StatePermute
+ *
+ * Description: The Keccak F1600 Permutation, with the AVX-512 kernel of
+ *              fips202_simd.c where the CPU has it, picked on the first
+ *              call, and the scalar version otherwise. The threads of
+ *              the library may make their first calls at once: they
+ *              all pick the same kernel and publish it atomically.
+ *
+ * Arguments:   - uint64_t *state: pointer to input/output Keccak state
+ **************************************************/
+void KeccakF1600_StatePermute(uint64_t *state) {
+#ifdef FIPS202_X86_SIMD
+    void (*impl)(uint64_t *) = __atomic_load_n(&KeccakF1600_StatePermute_impl, __ATOMIC_ACQUIRE);
+
+    if (impl == NULL) {
+        __builtin_cpu_init();
+        impl = __builtin_cpu_supports("avx512f") ? KeccakF1600_StatePermute_avx512 : KeccakF1600_StatePermute_ref;
+        __atomic_store_n(&KeccakF1600_StatePermute_impl, impl, __ATOMIC_RELEASE);
+    }
+    impl(state);
+#else
+    KeccakF1600_StatePermute_ref(state);
+#endif
+}
+
 /*************************************************
  * Name:        keccak_absorb
  *
@@ -522,6 +554,48 @@ static void keccak_inc_squeeze(uint8_t *h, size_t outlen,
     }
 }
 
+/*************************************************
+ * Name:        keccak_inc_squeeze_lanes
+ *
+ * Description: Incremental Keccak squeeze by whole 64-bit lanes; the
+ *              bytes of the last lane past outlen are discarded.
+ *              The lanes are copied from the state straight to the
+ *              output, a whole block at a time after each permutation,
+ *              with a single memcpy on little-endian targets.
+ *              The not-yet-squeezed bytes must start a lane, which
+ *              holds if the state is only squeezed with this function.
+ *
+ * Arguments:   - uint8_t *h: pointer to output bytes
+ *              - size_t outlen: number of bytes to be squeezed
+ *              - uint64_t *s_inc: pointer to input/output incremental state
+ *                First 25 values represent Keccak state.
+ *                26th value represents the not-yet-squeezed bytes.
+ *              - uint32_t r: rate in bytes, a multiple of 8
+ **************************************************/
+static void keccak_inc_squeeze_lanes(uint8_t *h, size_t outlen,
+                                     uint64_t *s_inc, uint32_t r) {
+    size_t n;
+
+    while (outlen > 0) {
+        if (s_inc[25] == 0) {
+            KeccakF1600_StatePermute(s_inc);
+            s_inc[25] = r;
+        }
+
+        n = outlen < s_inc[25] ? outlen : (size_t)s_inc[25];
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(h, (const uint8_t *)s_inc + (r - s_inc[25]), n);
+#else
+        for (size_t i = 0; i < n; i++) {
+            h[i] = (uint8_t)(s_inc[(r - s_inc[25] + i) >> 3] >> (8 * ((r - s_inc[25] + i) & 0x07)));
+        }
+#endif
+        h += n;
+        outlen -= n;
+        s_inc[25] -= (n + 7) & ~(size_t)7;
+    }
+}
+
 void shake128_inc_init(shake128incctx *state) {
     keccak_inc_init(state->ctx);
 }
@@ -554,6 +628,10 @@ void shake256_inc_squeeze(uint8_t *output, size_t outlen, shake256incctx *state)
     keccak_inc_squeeze(output, outlen, state->ctx, SHAKE256_RATE);
 }
 
+void shake256_inc_squeeze_lanes(uint8_t *output, size_t outlen, shake256incctx *state) {
+    keccak_inc_squeeze_lanes(output, outlen, state->ctx, SHAKE256_RATE);
+}
+
 
 /*************************************************
  * Name:        shake128_absorb
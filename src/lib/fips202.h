@@ -46,6 +46,8 @@ typedef struct {
     uint64_t ctx[26];
 } sha3_512incctx;
 
+void KeccakF1600_StatePermute(uint64_t *state);
+
 void shake128_absorb(shake128ctx *state, const uint8_t *input, size_t inlen);
 
 void shake128_squeezeblocks(uint8_t *output, size_t nblocks, shake128ctx *state);
@@ -62,6 +64,7 @@ void shake256_inc_init(shake256incctx *state);
 void shake256_inc_absorb(shake256incctx *state, const uint8_t *input, size_t inlen);
 void shake256_inc_finalize(shake256incctx *state);
 void shake256_inc_squeeze(uint8_t *output, size_t outlen, shake256incctx *state);
+void shake256_inc_squeeze_lanes(uint8_t *output, size_t outlen, shake256incctx *state);
 
 void shake128(uint8_t *output, size_t outlen,
               const uint8_t *input, size_t inlen);
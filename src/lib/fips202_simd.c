@@ -0,0 +1,272 @@
+/**
+ * @file fips202_simd.c
+ * @brief AVX-512 kernel of the Keccak F1600 permutation of a single state
+ *
+ * The state sits in the low 5 words of 5 512-bit registers, word x of register k holding the lane (x, y) of the
+ * diagonal y = k - c.x mod 5. Whatever c, a register has one lane of every column, at word x: theta sums the
+ * registers with ternary logic and gets the neighbouring columns with two word permutations, rho is a rotation by a
+ * vector of counts per register, and chi combines every register with word rotations of two others in one ternary
+ * logic instruction. From the diagonals c = 1, 2, 3 and 4, pi sends every register to a single register of the
+ * diagonal (1 + c) / 3c, so that it is one word permutation per register, merged with the rotations of chi: the
+ * rounds go through the diagonals 2, 3, 1, 4 and 0. The planes, the diagonal 0, which the state is loaded from and
+ * stored to, are moved to the diagonal 2 every 4 rounds with masked moves only.
+ * Every round takes 17 permutations, against 27 with the planes in the registers and pi gathering them, the
+ * permutations being the bottleneck of the kernel.
+ */
+
+#include <stdint.h>
+
+#include "fips202_simd.h"
+
+#ifdef FIPS202_X86_SIMD
+#include <immintrin.h>
+
+#define NROUNDS 24
+
+/* Keccak round constants */
+static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL,
+    0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL,
+    0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL,
+    0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL,
+    0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/* Rotations of rho of the words of register k of diagonal c, at [c][k] */
+static const uint64_t keccak_rho[5][5][8] = {
+    {{0}},
+    {
+        {0, 2, 15, 25, 20, 0, 0, 0},
+        {36, 1, 61, 21, 39, 0, 0, 0},
+        {3, 44, 62, 56, 8, 0, 0, 0},
+        {41, 10, 6, 28, 14, 0, 0, 0},
+        {18, 45, 43, 55, 27, 0, 0, 0}
+    },
+    {
+        {0, 45, 6, 56, 39, 0, 0, 0},
+        {36, 2, 43, 28, 8, 0, 0, 0},
+        {3, 1, 15, 55, 14, 0, 0, 0},
+        {41, 44, 61, 25, 27, 0, 0, 0},
+        {18, 10, 62, 21, 20, 0, 0, 0}
+    },
+    {
+        {0, 10, 61, 55, 8, 0, 0, 0},
+        {36, 45, 62, 25, 14, 0, 0, 0},
+        {3, 2, 6, 21, 27, 0, 0, 0},
+        {41, 1, 43, 56, 20, 0, 0, 0},
+        {18, 44, 15, 28, 39, 0, 0, 0}
+    },
+    {
+        {0, 44, 43, 21, 14, 0, 0, 0},
+        {36, 10, 15, 56, 27, 0, 0, 0},
+        {3, 45, 61, 28, 20, 0, 0, 0},
+        {41, 2, 62, 55, 39, 0, 0, 0},
+        {18, 1, 6, 25, 8, 0, 0, 0}
+    }
+};
+
+/* Word permutations of pi from diagonal c, at [c][k] for new register k */
+static const uint64_t keccak_pi[5][5][8] = {
+    {{0}},
+    {
+        {0, 4, 3, 2, 1, 0, 0, 0},
+        {3, 2, 1, 0, 4, 0, 0, 0},
+        {1, 0, 4, 3, 2, 0, 0, 0},
+        {4, 3, 2, 1, 0, 0, 0, 0},
+        {2, 1, 0, 4, 3, 0, 0, 0}
+    },
+    {
+        {0, 2, 4, 1, 3, 0, 0, 0},
+        {3, 0, 2, 4, 1, 0, 0, 0},
+        {1, 3, 0, 2, 4, 0, 0, 0},
+        {4, 1, 3, 0, 2, 0, 0, 0},
+        {2, 4, 1, 3, 0, 0, 0, 0}
+    },
+    {
+        {0, 3, 1, 4, 2, 0, 0, 0},
+        {3, 1, 4, 2, 0, 0, 0, 0},
+        {1, 4, 2, 0, 3, 0, 0, 0},
+        {4, 2, 0, 3, 1, 0, 0, 0},
+        {2, 0, 3, 1, 4, 0, 0, 0}
+    },
+    {
+        {0, 1, 2, 3, 4, 0, 0, 0},
+        {3, 4, 0, 1, 2, 0, 0, 0},
+        {1, 2, 3, 4, 0, 0, 0, 0},
+        {4, 0, 1, 2, 3, 0, 0, 0},
+        {2, 3, 4, 0, 1, 0, 0, 0}
+    }
+};
+
+/* The same followed by a rotation of the words by 1 */
+static const uint64_t keccak_pi_next[5][5][8] = {
+    {{0}},
+    {
+        {4, 3, 2, 1, 0, 0, 0, 0},
+        {2, 1, 0, 4, 3, 0, 0, 0},
+        {0, 4, 3, 2, 1, 0, 0, 0},
+        {3, 2, 1, 0, 4, 0, 0, 0},
+        {1, 0, 4, 3, 2, 0, 0, 0}
+    },
+    {
+        {2, 4, 1, 3, 0, 0, 0, 0},
+        {0, 2, 4, 1, 3, 0, 0, 0},
+        {3, 0, 2, 4, 1, 0, 0, 0},
+        {1, 3, 0, 2, 4, 0, 0, 0},
+        {4, 1, 3, 0, 2, 0, 0, 0}
+    },
+    {
+        {3, 1, 4, 2, 0, 0, 0, 0},
+        {1, 4, 2, 0, 3, 0, 0, 0},
+        {4, 2, 0, 3, 1, 0, 0, 0},
+        {2, 0, 3, 1, 4, 0, 0, 0},
+        {0, 3, 1, 4, 2, 0, 0, 0}
+    },
+    {
+        {1, 2, 3, 4, 0, 0, 0, 0},
+        {4, 0, 1, 2, 3, 0, 0, 0},
+        {2, 3, 4, 0, 1, 0, 0, 0},
+        {0, 1, 2, 3, 4, 0, 0, 0},
+        {3, 4, 0, 1, 2, 0, 0, 0}
+    }
+};
+
+/* The same followed by a rotation of the words by 2 */
+static const uint64_t keccak_pi_next2[5][5][8] = {
+    {{0}},
+    {
+        {3, 2, 1, 0, 4, 0, 0, 0},
+        {1, 0, 4, 3, 2, 0, 0, 0},
+        {4, 3, 2, 1, 0, 0, 0, 0},
+        {2, 1, 0, 4, 3, 0, 0, 0},
+        {0, 4, 3, 2, 1, 0, 0, 0}
+    },
+    {
+        {4, 1, 3, 0, 2, 0, 0, 0},
+        {2, 4, 1, 3, 0, 0, 0, 0},
+        {0, 2, 4, 1, 3, 0, 0, 0},
+        {3, 0, 2, 4, 1, 0, 0, 0},
+        {1, 3, 0, 2, 4, 0, 0, 0}
+    },
+    {
+        {1, 4, 2, 0, 3, 0, 0, 0},
+        {4, 2, 0, 3, 1, 0, 0, 0},
+        {2, 0, 3, 1, 4, 0, 0, 0},
+        {0, 3, 1, 4, 2, 0, 0, 0},
+        {3, 1, 4, 2, 0, 0, 0, 0}
+    },
+    {
+        {2, 3, 4, 0, 1, 0, 0, 0},
+        {0, 1, 2, 3, 4, 0, 0, 0},
+        {3, 4, 0, 1, 2, 0, 0, 0},
+        {1, 2, 3, 4, 0, 0, 0, 0},
+        {4, 0, 1, 2, 3, 0, 0, 0}
+    }
+};
+
+/* Source register of pi from diagonal c, at [c][k] for new register k */
+static const uint8_t keccak_pi_source[5][5] = {
+    {0, 0, 0, 0, 0},
+    {0, 3, 1, 4, 2},
+    {0, 1, 2, 3, 4},
+    {0, 4, 3, 2, 1},
+    {0, 2, 4, 1, 3}
+};
+
+#define LOAD_INDEX(t) _mm512_loadu_si512((const void *) (t))
+
+
+/**
+ * @brief Moves the planes of the state to the diagonal 2: word x of new register k is word x of plane k - 2x
+ */
+__attribute__((target("avx512f")))
+static inline void keccak_planes_to_diagonal(__m512i *A) {
+    __m512i B[5];
+
+    for (size_t k = 0; k < 5; k++) {
+        B[k] = A[k];
+        for (size_t x = 1; x < 5; x++) {
+            B[k] = _mm512_mask_mov_epi64(B[k], (__mmask8) (1 << x), A[(k + 15 - 2 * x) % 5]);
+        }
+    }
+    for (size_t k = 0; k < 5; k++) {
+        A[k] = B[k];
+    }
+}
+
+
+/**
+ * @brief A round of the permutation, from the diagonal c to the diagonal (1 + c) / 3c
+ *
+ * @param[in,out] A Registers of the state
+ * @param[in] c Diagonal of the registers, 1 to 4
+ * @param[in] next Diagonal after pi
+ * @param[in] rc Round constant
+ */
+__attribute__((target("avx512f"), always_inline))
+static inline void keccak_round_avx512(__m512i *A, size_t c, size_t next, uint64_t rc) {
+    const __m512i shift = _mm512_setr_epi64(1, 2, 3, 4, 0, 5, 6, 7);
+    const __m512i unshift = _mm512_setr_epi64(4, 0, 1, 2, 3, 5, 6, 7);
+    __m512i B[5], B1[5], B2[5], C, D, E;
+
+    // theta and rho
+    C = _mm512_ternarylogic_epi64(A[0], A[1], A[2], 0x96);
+    C = _mm512_ternarylogic_epi64(C, A[3], A[4], 0x96);
+    D = _mm512_permutexvar_epi64(unshift, C);
+    E = _mm512_rol_epi64(_mm512_permutexvar_epi64(shift, C), 1);
+    for (size_t k = 0; k < 5; k++) {
+        A[k] = _mm512_rolv_epi64(_mm512_ternarylogic_epi64(A[k], D, E, 0x96), LOAD_INDEX(keccak_rho[c][k]));
+    }
+
+    // pi, with the words rotated by 1 and 2 for chi
+    for (size_t k = 0; k < 5; k++) {
+        const __m512i a = A[keccak_pi_source[c][k]];
+
+        B[k] = _mm512_permutexvar_epi64(LOAD_INDEX(keccak_pi[c][k]), a);
+        B1[k] = _mm512_permutexvar_epi64(LOAD_INDEX(keccak_pi_next[c][k]), a);
+        B2[k] = _mm512_permutexvar_epi64(LOAD_INDEX(keccak_pi_next2[c][k]), a);
+    }
+
+    // chi: lane (x + 1, y) is in the register after next words further, lane (x + 2, y) twice as far
+    for (size_t k = 0; k < 5; k++) {
+        A[k] = _mm512_ternarylogic_epi64(B[k], B1[(k + next) % 5], B2[(k + 2 * next) % 5], 0xd2);
+    }
+
+    // iota, lane (0, 0) being word 0 of register 0 on every diagonal
+    A[0] = _mm512_xor_si512(A[0], _mm512_maskz_set1_epi64(0x01, (long long) rc));
+}
+
+
+/**
+ * @brief The Keccak F1600 permutation of a single state (512-bit lanes)
+ *
+ * @param[in,out] state Pointer to the state, word x + 5y at state[x + 5y]
+ */
+__attribute__((target("avx512f")))
+void KeccakF1600_StatePermute_avx512(uint64_t *state) {
+    __m512i A[5];
+
+    for (size_t y = 0; y < 5; y++) {
+        A[y] = _mm512_maskz_loadu_epi64(0x1f, state + 5 * y);
+    }
+
+    for (size_t round = 0; round < NROUNDS; round += 4) {
+        keccak_planes_to_diagonal(A);
+        keccak_round_avx512(A, 2, 3, KeccakF_RoundConstants[round]);
+        keccak_round_avx512(A, 3, 1, KeccakF_RoundConstants[round + 1]);
+        keccak_round_avx512(A, 1, 4, KeccakF_RoundConstants[round + 2]);
+        keccak_round_avx512(A, 4, 0, KeccakF_RoundConstants[round + 3]);
+    }
+
+    for (size_t y = 0; y < 5; y++) {
+        _mm512_mask_storeu_epi64(state + 5 * y, 0x1f, A[y]);
+    }
+}
+#endif
@@ -0,0 +1,22 @@
+#ifndef FIPS202_SIMD_H
+#define FIPS202_SIMD_H
+
+/**
+ * @file fips202_simd.h
+ * @brief Header file for fips202_simd.c
+ *
+ * The kernel permutes a single Keccak state, laid out as in fips202.c, and gives the same result as the scalar
+ * permutation; fips202.c picks it at runtime when the CPU has AVX-512.
+ */
+
+#include <stdint.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define FIPS202_X86_SIMD
+#endif
+
+#ifdef FIPS202_X86_SIMD
+void KeccakF1600_StatePermute_avx512(uint64_t *state);
+#endif
+
+#endif
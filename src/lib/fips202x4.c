@@ -0,0 +1,484 @@
+/**
+ * @file fips202x4.c
+ * @brief SHAKE-256 on 2, 4 or 8 independent states at once
+ *
+ * The states are interleaved word by word, so that word i of the 2 lanes loads into a 128-bit register, word i of the
+ * 4 lanes into a 256-bit one and word i of the 8 lanes into a 512-bit one. The permutation has an SSE2 kernel and an
+ * AVX-512VL one on 2 lanes, an AVX2 kernel and an AVX-512VL one on 4 lanes, the AVX-512VL ones with native rotations
+ * and ternary logic for chi, and an AVX-512F one on 8 lanes; without them each lane goes through the scalar
+ * permutation of fips202.c, and 8 lanes without AVX-512 through the 4-lane kernel twice. The kernels are compiled
+ * with per-function target attributes and picked at runtime depending on the features of the CPU.
+ * Apart from the permutation, the incremental API follows the one of fips202.c, with the same rate and padding, so
+ * that every lane squeezes the bytes shake256_inc_squeeze would.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fips202x4.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define FIPS202X4_X86_SIMD
+    #include <immintrin.h>
+#endif
+
+#define NROUNDS 24
+#define WORD(i, j) (100 * ((j) / 4) + 4 * (i) + (j) % 4) /*!< Index of word i of lane j of a 4- or 8-lane state */
+#define WORDX(i, j, lanes) ((lanes) == 2 ? 2 * (i) + (j) : WORD(i, j)) /*!< Index of word i of lane j of any state */
+
+#ifdef FIPS202X4_X86_SIMD
+/* Keccak round constants */
+static const uint64_t KeccakF_RoundConstants[NROUNDS] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL,
+    0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL,
+    0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL,
+    0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL,
+    0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/* Rotation of word x + 5y by rho */
+static const uint8_t keccak_rho[25] = {
+     0,  1, 62, 28, 27,
+    36, 44,  6, 55, 20,
+     3, 10, 43, 25, 39,
+    41, 45, 15, 21,  8,
+    18,  2, 61, 56, 14
+};
+
+/* Destination of word x + 5y by pi: y + 5(2x + 3y mod 5) */
+static const uint8_t keccak_pi[25] = {
+     0, 10, 20,  5, 15,
+    16,  1, 11, 21,  6,
+     7, 17,  2, 12, 22,
+    23,  8, 18,  3, 13,
+    14, 24,  9, 19,  4
+};
+
+
+/**
+ * Defines a permutation of the interleaved states in registers of type V, with the loads and stores of word i, the
+ * XOR, the rotation, chi (a ^ (~b & c)) and the broadcast of a round constant of the instruction set
+ */
+#define KECCAK_X_PERMUTE(name, isa, V, LOAD, STORE, XOR, ROL, CHI, SET1)                                        \
+    __attribute__((target(isa)))                                                                                   \
+    static void name(uint64_t *state) {                                                                            \
+        V A[25], B[25], C[5], D;                                                                                   \
+                                                                                                                   \
+        for (size_t i = 0; i < 25; i++) {                                                                          \
+            A[i] = LOAD(state, i);                                                                                 \
+        }                                                                                                          \
+        for (size_t round = 0; round < NROUNDS; round++) {                                                         \
+            _Pragma("GCC unroll 5")                                                                                \
+            for (size_t x = 0; x < 5; x++) {                                                                       \
+                C[x] = XOR(XOR(XOR(A[x], A[x + 5]), XOR(A[x + 10], A[x + 15])), A[x + 20]);                        \
+            }                                                                                                      \
+            _Pragma("GCC unroll 5")                                                                                \
+            for (size_t x = 0; x < 5; x++) {                                                                       \
+                D = XOR(C[(x + 4) % 5], ROL(C[(x + 1) % 5], 1));                                                   \
+                _Pragma("GCC unroll 5")                                                                            \
+                for (size_t y = 0; y < 25; y += 5) {                                                               \
+                    A[x + y] = XOR(A[x + y], D);                                                                   \
+                }                                                                                                  \
+            }                                                                                                      \
+            _Pragma("GCC unroll 25")                                                                               \
+            for (size_t i = 0; i < 25; i++) {                                                                      \
+                B[keccak_pi[i]] = ROL(A[i], keccak_rho[i]);                                                        \
+            }                                                                                                      \
+            _Pragma("GCC unroll 5")                                                                                \
+            for (size_t y = 0; y < 25; y += 5) {                                                                   \
+                _Pragma("GCC unroll 5")                                                                            \
+                for (size_t x = 0; x < 5; x++) {                                                                   \
+                    A[x + y] = CHI(B[x + y], B[(x + 1) % 5 + y], B[(x + 2) % 5 + y]);                              \
+                }                                                                                                  \
+            }                                                                                                      \
+            A[0] = XOR(A[0], SET1(KeccakF_RoundConstants[round]));                                                 \
+        }                                                                                                          \
+        for (size_t i = 0; i < 25; i++) {                                                                          \
+            STORE(state, i, A[i]);                                                                                 \
+        }                                                                                                          \
+    }
+
+#define SSE2_LOAD(s, i) _mm_loadu_si128((const __m128i *) ((s) + 2 * (i)))
+#define SSE2_STORE(s, i, a) _mm_storeu_si128((__m128i *) ((s) + 2 * (i)), (a))
+#define SSE2_ROL(a, n) \
+    _mm_or_si128(_mm_sll_epi64((a), _mm_cvtsi32_si128(n)), _mm_srl_epi64((a), _mm_cvtsi32_si128(64 - (n))))
+#define SSE2_CHI(a, b, c) _mm_xor_si128((a), _mm_andnot_si128((b), (c)))
+#define SSE2_SET1(c) _mm_set1_epi64x((long long) (c))
+
+#define AVX512VL_ROL128(a, n) _mm_rolv_epi64((a), _mm_set1_epi64x(n))
+#define AVX512VL_CHI128(a, b, c) _mm_ternarylogic_epi64((a), (b), (c), 0xd2)
+
+#define AVX2_LOAD(s, i) _mm256_loadu_si256((const __m256i *) ((s) + 4 * (i)))
+#define AVX2_STORE(s, i, a) _mm256_storeu_si256((__m256i *) ((s) + 4 * (i)), (a))
+#define AVX2_ROL(a, n) \
+    _mm256_or_si256(_mm256_sll_epi64((a), _mm_cvtsi32_si128(n)), _mm256_srl_epi64((a), _mm_cvtsi32_si128(64 - (n))))
+#define AVX2_CHI(a, b, c) _mm256_xor_si256((a), _mm256_andnot_si256((b), (c)))
+#define AVX2_SET1(c) _mm256_set1_epi64x((long long) (c))
+
+#define AVX512VL_ROL(a, n) _mm256_rolv_epi64((a), _mm256_set1_epi64x(n))
+#define AVX512VL_CHI(a, b, c) _mm256_ternarylogic_epi64((a), (b), (c), 0xd2)
+
+#define AVX512_LOAD(s, i) \
+    _mm512_inserti64x4(_mm512_castsi256_si512(AVX2_LOAD((s), (i))), AVX2_LOAD((s) + 100, (i)), 1)
+#define AVX512_STORE(s, i, a) \
+    do {                                                                     \
+        AVX2_STORE((s), (i), _mm512_castsi512_si256(a));                     \
+        AVX2_STORE((s) + 100, (i), _mm512_extracti64x4_epi64((a), 1));       \
+    } while (0)
+#define AVX512_ROL(a, n) _mm512_rolv_epi64((a), _mm512_set1_epi64(n))
+#define AVX512_CHI(a, b, c) _mm512_ternarylogic_epi64((a), (b), (c), 0xd2)
+#define AVX512_SET1(c) _mm512_set1_epi64((long long) (c))
+
+KECCAK_X_PERMUTE(keccakx2_permute_sse2, "sse2", __m128i, SSE2_LOAD, SSE2_STORE, _mm_xor_si128, SSE2_ROL, SSE2_CHI,
+                 SSE2_SET1)
+KECCAK_X_PERMUTE(keccakx2_permute_avx512vl, "avx512f,avx512vl", __m128i, SSE2_LOAD, SSE2_STORE, _mm_xor_si128,
+                 AVX512VL_ROL128, AVX512VL_CHI128, SSE2_SET1)
+KECCAK_X_PERMUTE(keccakx4_permute_avx2, "avx2", __m256i, AVX2_LOAD, AVX2_STORE, _mm256_xor_si256, AVX2_ROL,
+                 AVX2_CHI, AVX2_SET1)
+KECCAK_X_PERMUTE(keccakx4_permute_avx512vl, "avx512f,avx512vl", __m256i, AVX2_LOAD, AVX2_STORE, _mm256_xor_si256,
+                 AVX512VL_ROL, AVX512VL_CHI, AVX2_SET1)
+KECCAK_X_PERMUTE(keccakx8_permute_avx512, "avx512f", __m512i, AVX512_LOAD, AVX512_STORE, _mm512_xor_si512,
+                 AVX512_ROL, AVX512_CHI, AVX512_SET1)
+#endif
+
+
+/**
+ * @brief Permutes the <b>lanes</b> lanes one after the other with the scalar permutation
+ */
+static void keccakx_permute_scalar(uint64_t *state, size_t lanes) {
+    uint64_t lane[25];
+
+    for (size_t j = 0; j < lanes; j++) {
+        for (size_t i = 0; i < 25; i++) {
+            lane[i] = state[WORDX(i, j, lanes)];
+        }
+        KeccakF1600_StatePermute(lane);
+        for (size_t i = 0; i < 25; i++) {
+            state[WORDX(i, j, lanes)] = lane[i];
+        }
+    }
+}
+
+static void keccakx2_permute_scalar(uint64_t *state) {
+    keccakx_permute_scalar(state, 2);
+}
+
+static void keccakx4_permute_scalar(uint64_t *state) {
+    keccakx_permute_scalar(state, 4);
+}
+
+
+/**
+ * @brief Permutes the 8 lanes as two 4-lane states
+ */
+static void keccakx8_permute_halves(uint64_t *state) {
+    KeccakF1600_StatePermute4x(state);
+    KeccakF1600_StatePermute4x(state + 100);
+}
+
+
+static void (*keccakx2_permute)(uint64_t *state) = NULL;
+static void (*keccakx4_permute)(uint64_t *state) = NULL;
+static void (*keccakx8_permute)(uint64_t *state) = NULL;
+
+/*
+ * The threads of the library may call the permutations for the first time at once: the kernels are read and
+ * published atomically, and every thread picks the same ones
+ */
+#ifdef FIPS202X4_X86_SIMD
+    #define KECCAKX_LOAD(f) __atomic_load_n(&(f), __ATOMIC_ACQUIRE)
+    #define KECCAKX_STORE(f, k) __atomic_store_n(&(f), (k), __ATOMIC_RELEASE)
+#else
+    #define KECCAKX_LOAD(f) (f)
+    #define KECCAKX_STORE(f, k) ((f) = (k))
+#endif
+
+/**
+ * @brief Picks the widest permutation kernels the CPU supports
+ */
+static void keccakx_resolve(void) {
+    void (*x2)(uint64_t *) = keccakx2_permute_scalar;
+    void (*x4)(uint64_t *) = keccakx4_permute_scalar;
+    void (*x8)(uint64_t *) = keccakx8_permute_halves;
+
+#ifdef FIPS202X4_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        x2 = keccakx2_permute_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        x4 = keccakx4_permute_avx2;
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        x8 = keccakx8_permute_avx512;
+        if (__builtin_cpu_supports("avx512vl")) {
+            x2 = keccakx2_permute_avx512vl;
+            x4 = keccakx4_permute_avx512vl;
+        }
+    }
+#endif
+    KECCAKX_STORE(keccakx2_permute, x2);
+    KECCAKX_STORE(keccakx4_permute, x4);
+    KECCAKX_STORE(keccakx8_permute, x8);
+}
+
+
+
+/**
+ * @brief The Keccak F1600 permutation of 2 interleaved states
+ *
+ * @param[in,out] state Pointer to the states, word i of lane j at state[2 * i + j]
+ */
+void KeccakF1600_StatePermute2x(uint64_t *state) {
+    void (*permute)(uint64_t *) = KECCAKX_LOAD(keccakx2_permute);
+
+    if (permute == NULL) {
+        keccakx_resolve();
+        permute = KECCAKX_LOAD(keccakx2_permute);
+    }
+    permute(state);
+}
+
+
+
+/**
+ * @brief The Keccak F1600 permutation of 4 interleaved states
+ *
+ * @param[in,out] state Pointer to the states, word i of lane j at state[4 * i + j]
+ */
+void KeccakF1600_StatePermute4x(uint64_t *state) {
+    void (*permute)(uint64_t *) = KECCAKX_LOAD(keccakx4_permute);
+
+    if (permute == NULL) {
+        keccakx_resolve();
+        permute = KECCAKX_LOAD(keccakx4_permute);
+    }
+    permute(state);
+}
+
+
+
+/**
+ * @brief The Keccak F1600 permutation of 8 interleaved states
+ *
+ * @param[in,out] state Pointer to the states, lanes 0 to 3 then lanes 4 to 7 as two 4-lane states
+ */
+void KeccakF1600_StatePermute8x(uint64_t *state) {
+    void (*permute)(uint64_t *) = KECCAKX_LOAD(keccakx8_permute);
+
+    if (permute == NULL) {
+        keccakx_resolve();
+        permute = KECCAKX_LOAD(keccakx8_permute);
+    }
+    permute(state);
+}
+
+
+
+/**
+ * @brief Permutation of a state of <b>lanes</b> lanes
+ */
+static void keccakx_permute(uint64_t *s, size_t lanes) {
+    if (lanes == 2) {
+        KeccakF1600_StatePermute2x(s);
+    } else if (lanes == 4) {
+        KeccakF1600_StatePermute4x(s);
+    } else {
+        KeccakF1600_StatePermute8x(s);
+    }
+}
+
+
+
+/**
+ * @brief Zeroes a state of <b>lanes</b> lanes and its byte counter
+ */
+static void keccakx_inc_init(uint64_t *s, size_t lanes) {
+    memset(s, 0x00, (25 * lanes + 1) * sizeof(uint64_t));
+}
+
+
+
+/**
+ * @brief Incremental absorb of <b>inlen</b> bytes in every lane, preceded by keccakx_inc_init
+ *
+ * As in keccak_inc_absorb, s[25 * lanes] is the number of absorbed bytes that have not been permuted.
+ */
+static void keccakx_inc_absorb(uint64_t *s, size_t lanes, uint32_t r, const uint8_t *const *input, size_t inlen) {
+    uint64_t *pos = s + 25 * lanes;
+    size_t done = 0, n;
+
+    while (done < inlen) {
+        n = inlen - done < r - *pos ? inlen - done : (size_t) (r - *pos);
+        for (size_t j = 0; j < lanes; j++) {
+            for (size_t i = 0; input[j] != NULL && i < n; i++) {
+                s[WORDX((*pos + i) >> 3, j, lanes)] ^= (uint64_t) input[j][done + i] << (8 * ((*pos + i) & 0x07));
+            }
+        }
+        *pos += n;
+        done += n;
+        if (*pos == r) {
+            keccakx_permute(s, lanes);
+            *pos = 0;
+        }
+    }
+}
+
+
+
+/**
+ * @brief Pads every lane with the domain-separation byte <b>p</b> and prepares the state for squeezing
+ */
+static void keccakx_inc_finalize(uint64_t *s, size_t lanes, uint32_t r, uint8_t p) {
+    uint64_t *pos = s + 25 * lanes;
+
+    for (size_t j = 0; j < lanes; j++) {
+        s[WORDX(*pos >> 3, j, lanes)] ^= (uint64_t) p << (8 * (*pos & 0x07));
+        s[WORDX((r - 1) >> 3, j, lanes)] ^= (uint64_t) 128 << (8 * ((r - 1) & 0x07));
+    }
+    *pos = 0;
+}
+
+
+
+/**
+ * @brief Copies <b>n</b> bytes of lane <b>j</b> from byte <b>offset</b> of a state of <b>lanes</b> lanes, a whole word
+ * at a time where they are aligned
+ */
+static void keccakx_store_lane(uint8_t *output, const uint64_t *s, size_t lanes, size_t j, size_t offset, size_t n) {
+    size_t i = 0, m;
+    uint64_t w;
+
+    while (i < n) {
+        w = s[WORDX((offset + i) >> 3, j, lanes)] >> (8 * ((offset + i) & 0x07));
+        m = 8 - ((offset + i) & 0x07);
+        m = m < n - i ? m : n - i;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (m == 8) {
+            memcpy(output + i, &w, 8);
+            i += 8;
+            continue;
+        }
+#endif
+        for (size_t k = 0; k < m; k++) {
+            output[i + k] = (uint8_t) (w >> (8 * k));
+        }
+        i += m;
+    }
+}
+
+
+
+/**
+ * @brief Incremental squeeze of <b>outlen</b> bytes from every lane
+ *
+ * As in keccak_inc_squeeze, s[25 * lanes] is the number of not-yet-squeezed bytes of the current block.
+ */
+static void keccakx_inc_squeeze(uint8_t *const *output, size_t lanes, uint32_t r, size_t outlen, uint64_t *s) {
+    uint64_t *pos = s + 25 * lanes;
+    size_t done = 0, n;
+
+    while (done < outlen) {
+        if (*pos == 0) {
+            keccakx_permute(s, lanes);
+            *pos = r;
+        }
+        n = outlen - done < *pos ? outlen - done : (size_t) *pos;
+        for (size_t j = 0; j < lanes; j++) {
+            if (output[j] != NULL) {
+                keccakx_store_lane(output[j] + done, s, lanes, j, r - *pos, n);
+            }
+        }
+        *pos -= n;
+        done += n;
+    }
+}
+
+
+
+void shake256x2_inc_init(shake256x2incctx *state) {
+    keccakx_inc_init(state->ctx, 2);
+}
+
+void shake256x2_inc_absorb(shake256x2incctx *state, const uint8_t *const input[2], size_t inlen) {
+    keccakx_inc_absorb(state->ctx, 2, SHAKE256_RATE, input, inlen);
+}
+
+void shake256x2_inc_finalize(shake256x2incctx *state) {
+    keccakx_inc_finalize(state->ctx, 2, SHAKE256_RATE, 0x1F);
+}
+
+void shake256x2_inc_squeeze(uint8_t *const output[2], size_t outlen, shake256x2incctx *state) {
+    keccakx_inc_squeeze(output, 2, SHAKE256_RATE, outlen, state->ctx);
+}
+
+
+
+void shake256x4_inc_init(shake256x4incctx *state) {
+    keccakx_inc_init(state->ctx, 4);
+}
+
+void shake256x4_inc_absorb(shake256x4incctx *state, const uint8_t *const input[4], size_t inlen) {
+    keccakx_inc_absorb(state->ctx, 4, SHAKE256_RATE, input, inlen);
+}
+
+void shake256x4_inc_finalize(shake256x4incctx *state) {
+    keccakx_inc_finalize(state->ctx, 4, SHAKE256_RATE, 0x1F);
+}
+
+void shake256x4_inc_squeeze(uint8_t *const output[4], size_t outlen, shake256x4incctx *state) {
+    keccakx_inc_squeeze(output, 4, SHAKE256_RATE, outlen, state->ctx);
+}
+
+
+
+/**
+ * @brief Splits a 4-lane state into single-lane states of the incremental API of fips202.c
+ *
+ * If the current block is all squeezed, as it is right after shake256x4_inc_finalize, the next one is computed first
+ * with a single 4-lane permutation, so that the single-lane states start squeezing without one of their own.
+ *
+ * @param[out] lanes Pointers to the single-lane states, NULL for the lanes to drop
+ * @param[in,out] state 4-lane state
+ */
+void shake256x4_inc_split(shake256incctx *const lanes[4], shake256x4incctx *state) {
+    if (state->ctx[100] == 0) {
+        KeccakF1600_StatePermute4x(state->ctx);
+        state->ctx[100] = SHAKE256_RATE;
+    }
+    for (size_t j = 0; j < 4; j++) {
+        if (lanes[j] == NULL) {
+            continue;
+        }
+        for (size_t i = 0; i < 25; i++) {
+            lanes[j]->ctx[i] = state->ctx[WORD(i, j)];
+        }
+        lanes[j]->ctx[25] = state->ctx[100];
+    }
+}
+
+
+
+void shake256x8_inc_init(shake256x8incctx *state) {
+    keccakx_inc_init(state->ctx, 8);
+}
+
+void shake256x8_inc_absorb(shake256x8incctx *state, const uint8_t *const input[8], size_t inlen) {
+    keccakx_inc_absorb(state->ctx, 8, SHAKE256_RATE, input, inlen);
+}
+
+void shake256x8_inc_finalize(shake256x8incctx *state) {
+    keccakx_inc_finalize(state->ctx, 8, SHAKE256_RATE, 0x1F);
+}
+
+void shake256x8_inc_squeeze(uint8_t *const output[8], size_t outlen, shake256x8incctx *state) {
+    keccakx_inc_squeeze(output, 8, SHAKE256_RATE, outlen, state->ctx);
+}
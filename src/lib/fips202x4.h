@@ -0,0 +1,53 @@
+#ifndef FIPS202X4_H
+#define FIPS202X4_H
+
+/**
+ * @file fips202x4.h
+ * @brief Header file of fips202x4.c
+ *
+ * The states hold 2, 4 or 8 independent SHAKE-256 instances, which absorb inputs of the same length and squeeze the same
+ * number of bytes. A lane whose input pointer is NULL absorbs nothing, a lane whose output pointer is NULL is not
+ * squeezed: the unused lanes of a permutation come for free.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fips202.h"
+
+// Context for the 2-lane incremental API: word i of lane j at ctx[2 * i + j], then the byte counter
+typedef struct {
+    uint64_t ctx[2 * 25 + 1];
+} shake256x2incctx;
+
+// Context for the 4-lane incremental API: word i of lane j at ctx[4 * i + j], then the byte counter
+typedef struct {
+    uint64_t ctx[4 * 25 + 1];
+} shake256x4incctx;
+
+// Context for the 8-lane incremental API: two 4-lane states, then the byte counter
+typedef struct {
+    uint64_t ctx[8 * 25 + 1];
+} shake256x8incctx;
+
+void KeccakF1600_StatePermute2x(uint64_t *state);
+void KeccakF1600_StatePermute4x(uint64_t *state);
+void KeccakF1600_StatePermute8x(uint64_t *state);
+
+void shake256x2_inc_init(shake256x2incctx *state);
+void shake256x2_inc_absorb(shake256x2incctx *state, const uint8_t *const input[2], size_t inlen);
+void shake256x2_inc_finalize(shake256x2incctx *state);
+void shake256x2_inc_squeeze(uint8_t *const output[2], size_t outlen, shake256x2incctx *state);
+
+void shake256x4_inc_init(shake256x4incctx *state);
+void shake256x4_inc_absorb(shake256x4incctx *state, const uint8_t *const input[4], size_t inlen);
+void shake256x4_inc_finalize(shake256x4incctx *state);
+void shake256x4_inc_squeeze(uint8_t *const output[4], size_t outlen, shake256x4incctx *state);
+void shake256x4_inc_split(shake256incctx *const lanes[4], shake256x4incctx *state);
+
+void shake256x8_inc_init(shake256x8incctx *state);
+void shake256x8_inc_absorb(shake256x8incctx *state, const uint8_t *const input[8], size_t inlen);
+void shake256x8_inc_finalize(shake256x8incctx *state);
+void shake256x8_inc_squeeze(uint8_t *const output[8], size_t outlen, shake256x8incctx *state);
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ * @file hqc_rng.c
+ * @brief Contexts of the random bytes and masks of the library
+ *
+ * hqc_rng_init derives a context as shake_prng_init always did, so that a context seeded with the entropy of the KATs
+ * gives their keys and ciphertexts; hqc_rng_init_drbg seeds one from an entropy source instead. The masks of a context
+ * are refilled in bulk with mask_rng_expand, from a key drawn from its generator.
+ *
+ * The masked routines draw their masks from the context bound to the calling thread by hqc_rng_bind, which the PKE
+ * functions do for the context they get; with no context bound, from the default one. The default context is shared
+ * by the whole process, as the global state of shake_prng used to be; built with HQC_RNG_TLS, every thread has a
+ * default context of its own instead, the one of the thread that calls shake_prng_init seeded as before and the others
+ * forked on their first use from a root context seeded alongside it.
+ */
+
+#include <string.h>
+
+#include "hqc_rng.h"
+#include "domains.h"
+
+#ifdef HQC_RNG_TLS
+    #include <pthread.h>
+#endif
+
+
+static hqc_rng hqc_rng_process;
+static HQC_THREAD_LOCAL hqc_rng *hqc_rng_bound = NULL;
+
+#ifdef HQC_RNG_TLS
+static pthread_mutex_t hqc_rng_process_lock = PTHREAD_MUTEX_INITIALIZER;
+static HQC_THREAD_LOCAL hqc_rng hqc_rng_thread;
+static HQC_THREAD_LOCAL int hqc_rng_thread_seeded = 0;
+#endif
+
+
+/**
+ * @brief Seeds the SHAKE-256 stream of a context with its entropy, personalization string and domain, the masks
+ * buffered discarded
+ */
+static void hqc_rng_absorb(hqc_rng *rng, const uint8_t *entropy_input, const uint8_t *personalization_string,
+                           uint32_t enlen, uint32_t perlen, uint8_t domain) {
+    rng->backend = HQC_RNG_SHAKE;
+#ifndef DRBG_DISABLED
+    drbg_clear(&rng->drbg);
+#endif
+    shake256_inc_init(&rng->prng);
+    shake256_inc_absorb(&rng->prng, entropy_input, enlen);
+    shake256_inc_absorb(&rng->prng, personalization_string, perlen);
+    shake256_inc_absorb(&rng->prng, &domain, 1);
+    shake256_inc_finalize(&rng->prng);
+    hqc_rng_masks_reset(rng);
+}
+
+
+
+/**
+ * @brief Seeds a context
+ *
+ * @param[out] rng Pointer to the context
+ * @param[in] entropy_input Pointer to input entropy bytes
+ * @param[in] personalization_string Pointer to the personalization string
+ * @param[in] enlen Length of entropy string in bytes
+ * @param[in] perlen Length of the personalization string in bytes
+ */
+void hqc_rng_init(hqc_rng *rng, const uint8_t *entropy_input, const uint8_t *personalization_string, uint32_t enlen,
+                  uint32_t perlen) {
+    hqc_rng_absorb(rng, entropy_input, personalization_string, enlen, perlen, PRNG_DOMAIN);
+}
+
+
+
+/**
+ * @brief Seeds a context with the DRBG of drbg.c
+ *
+ * @param[out] rng Pointer to the context
+ * @param[in] entropy Entropy source of the seeds, drbg_entropy_system if NULL
+ * @param[in] personalization_string Pointer to the personalization string
+ * @param[in] perlen Length of the personalization string in bytes
+ * @returns 0, or -1 if the entropy source failed, always with DRBG_DISABLED, in which case the context generates nothing
+ */
+int hqc_rng_init_drbg(hqc_rng *rng, drbg_entropy_t entropy, const uint8_t *personalization_string, uint32_t perlen) {
+    rng->backend = HQC_RNG_DRBG;
+    memset(&rng->prng, 0x00, sizeof(rng->prng));
+    hqc_rng_masks_reset(rng);
+#ifdef DRBG_DISABLED
+    (void) entropy;
+    (void) personalization_string;
+    (void) perlen;
+    return -1;
+#else
+    return drbg_init(&rng->drbg, entropy, personalization_string, perlen);
+#endif
+}
+
+
+
+/**
+ * @brief Seeds a context from HQC_RNG_FORK_BYTES bytes of another one, for a thread of its own
+ *
+ * The child of a SHAKE-256 stream is seeded in the PRNG_FORK_DOMAIN domain, so that its stream is not the one of a
+ * context seeded with the same bytes by hqc_rng_init. The child of a DRBG is a DRBG with the same entropy source and
+ * the bytes as personalization string, seeded if its entropy source works or the parent is.
+ *
+ * @param[out] child Pointer to the new context
+ * @param[in,out] parent Pointer to the context it is drawn from
+ */
+void hqc_rng_fork(hqc_rng *child, hqc_rng *parent) {
+    uint8_t seed[HQC_RNG_FORK_BYTES] = {0};
+    const int drawn = hqc_rng_bytes(parent, seed, HQC_RNG_FORK_BYTES) == 0;
+
+    if (parent->backend == HQC_RNG_DRBG) {
+#ifdef DRBG_DISABLED
+        (void) drawn;
+        hqc_rng_init_drbg(child, NULL, seed, HQC_RNG_FORK_BYTES);
+#else
+        hqc_rng_init_drbg(child, parent->drbg.entropy, seed, HQC_RNG_FORK_BYTES);
+        // the bytes of a seeded parent are unpredictable on their own, should the entropy source of the child fail
+        child->drbg.seeded |= drawn;
+#endif
+    } else {
+        hqc_rng_absorb(child, seed, NULL, HQC_RNG_FORK_BYTES, 0, PRNG_FORK_DOMAIN);
+    }
+    memset(seed, 0x00, HQC_RNG_FORK_BYTES);
+}
+
+
+
+/**
+ * @brief Whether a context can generate random bytes
+ *
+ * @param[in] rng Pointer to the context
+ * @returns 0, or -1 if its DRBG never got the bytes of its entropy source
+ */
+int hqc_rng_status(const hqc_rng *rng) {
+#ifdef DRBG_DISABLED
+    return rng->backend == HQC_RNG_DRBG ? -1 : 0;
+#else
+    return rng->backend == HQC_RNG_DRBG && !rng->drbg.seeded ? -1 : 0;
+#endif
+}
+
+
+
+/**
+ * @brief Random bytes of a context
+ *
+ * @param[in,out] rng Pointer to the context
+ * @param[out] output Pointer to output
+ * @param[in] outlen length of output in bytes
+ * @returns 0, or -1 if the context cannot generate bytes (see hqc_rng_status), in which case nothing is written
+ */
+int hqc_rng_bytes(hqc_rng *rng, uint8_t *output, size_t outlen) {
+    if (rng->backend == HQC_RNG_DRBG) {
+#ifdef DRBG_DISABLED
+        return -1;
+#else
+        return drbg_generate(&rng->drbg, output, outlen);
+#endif
+    }
+    shake256_inc_squeeze(output, outlen, &rng->prng);
+    return 0;
+}
+
+
+
+/**
+ * @brief Random bytes for the masks, from the buffer of a context, refilled from a fresh key of its generator when it
+ * runs out
+ *
+ * A context that cannot generate bytes gives masks of an all-zero key, never secret: the KEM functions refuse such a
+ * context before drawing any.
+ *
+ * @param[in,out] rng Pointer to the context
+ * @param[out] output Pointer to output
+ * @param[in] outlen length of output in bytes
+ */
+void hqc_rng_masks(hqc_rng *rng, uint8_t *output, size_t outlen) {
+    uint8_t key[MASK_RNG_KEY_BYTES];
+
+    while (outlen > 0) {
+        if (rng->masks_left == 0) {
+            if (hqc_rng_bytes(rng, key, MASK_RNG_KEY_BYTES) != 0) {
+                memset(key, 0x00, MASK_RNG_KEY_BYTES);
+            }
+            mask_rng_expand(rng->masks, key);
+            memset(key, 0x00, MASK_RNG_KEY_BYTES);
+            rng->masks_left = MASK_RNG_BUFFER_BYTES;
+        }
+
+        uint8_t *masks = rng->masks + MASK_RNG_BUFFER_BYTES - rng->masks_left;
+        const size_t n = outlen < rng->masks_left ? outlen : rng->masks_left;
+        memcpy(output, masks, n);
+        // the bytes handed out are not kept in the buffer
+        memset(masks, 0x00, n);
+        rng->masks_left -= n;
+        output += n;
+        outlen -= n;
+    }
+}
+
+
+
+/**
+ * @brief Discards the masks left in the buffer of a context, so that the next ones are derived from the current
+ * state of its generator
+ *
+ * @param[in,out] rng Pointer to the context
+ */
+void hqc_rng_masks_reset(hqc_rng *rng) {
+    memset(rng->masks, 0x00, MASK_RNG_BUFFER_BYTES);
+    rng->masks_left = 0;
+}
+
+
+
+/**
+ * @brief Seeds the default context of the calling thread, and with HQC_RNG_TLS the root of the default contexts of the
+ * other threads
+ *
+ * @param[in] entropy_input Pointer to input entropy bytes
+ * @param[in] personalization_string Pointer to the personalization string
+ * @param[in] enlen Length of entropy string in bytes
+ * @param[in] perlen Length of the personalization string in bytes
+ */
+void hqc_rng_seed_default(const uint8_t *entropy_input, const uint8_t *personalization_string, uint32_t enlen,
+                          uint32_t perlen) {
+#ifdef HQC_RNG_TLS
+    pthread_mutex_lock(&hqc_rng_process_lock);
+    hqc_rng_absorb(&hqc_rng_process, entropy_input, personalization_string, enlen, perlen, PRNG_FORK_DOMAIN);
+    pthread_mutex_unlock(&hqc_rng_process_lock);
+    hqc_rng_thread_seeded = 1;
+#endif
+    hqc_rng_init(hqc_rng_default(), entropy_input, personalization_string, enlen, perlen);
+}
+
+
+
+/**
+ * @brief Seeds the default context of the calling thread with the DRBG, and with HQC_RNG_TLS the root of the default
+ * contexts of the other threads, whose forks are then DRBGs too
+ *
+ * @param[in] entropy Entropy source of the seeds, drbg_entropy_system if NULL
+ * @returns 0, or -1 if the entropy source failed, in which case the default contexts generate nothing
+ */
+int hqc_rng_seed_default_drbg(drbg_entropy_t entropy) {
+    int status = 0;
+
+#ifdef HQC_RNG_TLS
+    pthread_mutex_lock(&hqc_rng_process_lock);
+    status |= hqc_rng_init_drbg(&hqc_rng_process, entropy, NULL, 0);
+    pthread_mutex_unlock(&hqc_rng_process_lock);
+    hqc_rng_thread_seeded = 1;
+#endif
+    status |= hqc_rng_init_drbg(hqc_rng_default(), entropy, NULL, 0);
+    return status;
+}
+
+
+
+/**
+ * @brief Default context of the calling thread: the one of the process, or with HQC_RNG_TLS the one of the thread,
+ * forked from the root context on its first use
+ *
+ * @returns a pointer to the context
+ */
+hqc_rng *hqc_rng_default(void) {
+#ifdef HQC_RNG_TLS
+    if (!hqc_rng_thread_seeded) {
+        pthread_mutex_lock(&hqc_rng_process_lock);
+        hqc_rng_fork(&hqc_rng_thread, &hqc_rng_process);
+        pthread_mutex_unlock(&hqc_rng_process_lock);
+        hqc_rng_thread_seeded = 1;
+    }
+    return &hqc_rng_thread;
+#else
+    return &hqc_rng_process;
+#endif
+}
+
+
+
+/**
+ * @brief Binds a context to the calling thread, the one the masked routines draw their masks from
+ *
+ * @param[in] rng Pointer to the context, NULL for the default one
+ * @returns the context bound before, to be bound back when done
+ */
+hqc_rng *hqc_rng_bind(hqc_rng *rng) {
+    hqc_rng *previous = hqc_rng_bound;
+
+    hqc_rng_bound = rng;
+    return previous;
+}
+
+
+
+/**
+ * @brief Context bound to the calling thread, the default one if none is
+ *
+ * @returns a pointer to the context
+ */
+hqc_rng *hqc_rng_current(void) {
+    return hqc_rng_bound != NULL ? hqc_rng_bound : hqc_rng_default();
+}
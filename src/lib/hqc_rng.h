@@ -0,0 +1,73 @@
+#ifndef HQC_RNG_H
+#define HQC_RNG_H
+
+/**
+ * @file hqc_rng.h
+ * @brief Header file of hqc_rng.c
+ *
+ * A context holds everything the library draws random bytes from: the generator of the seeds and messages, and the
+ * buffer of masks of the masked routines. Contexts share nothing, so that threads with a context each run the KEM
+ * without a lock. The generator is the deterministic SHAKE-256 stream of a seed, the one of the KATs and the
+ * benchmarks, or the DRBG of drbg.c, seeded and reseeded from an entropy source. A context whose DRBG never got the
+ * bytes of its entropy source generates nothing, and the KEM functions refuse it. Built with DRBG_DISABLED, as on the
+ * board, a context holds no DRBG and one seeded with hqc_rng_init_drbg is such a context.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "drbg.h"
+#include "fips202.h"
+#include "mask_rng.h"
+
+// Storage class of the per-thread variables, none in the single-threaded builds of the board
+#if defined(CROSSCOMPILE)
+    #define HQC_THREAD_LOCAL
+#elif defined(__GNUC__)
+    #define HQC_THREAD_LOCAL __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    #define HQC_THREAD_LOCAL _Thread_local
+#else
+    #define HQC_THREAD_LOCAL
+#endif
+
+#define HQC_RNG_FORK_BYTES 64 /*!< Bytes squeezed from a context to seed a child context */
+
+/**
+ * Generators of the random bytes of a context
+ */
+typedef enum {
+    HQC_RNG_SHAKE = 0,
+    HQC_RNG_DRBG
+} hqc_rng_backend_t;
+
+/**
+ * Random source of the library, all zeros before its seeding; a context must not be used by two threads at once
+ */
+typedef struct hqc_rng {
+    hqc_rng_backend_t backend; /*!< Generator of the random bytes */
+    shake256incctx prng; /*!< SHAKE-256 state of the random bytes, with HQC_RNG_SHAKE */
+#ifndef DRBG_DISABLED
+    drbg_state drbg; /*!< DRBG of the random bytes, with HQC_RNG_DRBG */
+#endif
+    uint8_t masks[MASK_RNG_BUFFER_BYTES]; /*!< Masks of the last refill, the ones handed out zeroed */
+    size_t masks_left; /*!< Masks of the buffer not handed out yet, at its end */
+} hqc_rng;
+
+void hqc_rng_init(hqc_rng *rng, const uint8_t *entropy_input, const uint8_t *personalization_string, uint32_t enlen,
+                  uint32_t perlen);
+int hqc_rng_init_drbg(hqc_rng *rng, drbg_entropy_t entropy, const uint8_t *personalization_string, uint32_t perlen);
+void hqc_rng_fork(hqc_rng *child, hqc_rng *parent);
+int hqc_rng_status(const hqc_rng *rng);
+int hqc_rng_bytes(hqc_rng *rng, uint8_t *output, size_t outlen);
+void hqc_rng_masks(hqc_rng *rng, uint8_t *output, size_t outlen);
+void hqc_rng_masks_reset(hqc_rng *rng);
+
+void hqc_rng_seed_default(const uint8_t *entropy_input, const uint8_t *personalization_string, uint32_t enlen,
+                          uint32_t perlen);
+int hqc_rng_seed_default_drbg(drbg_entropy_t entropy);
+hqc_rng *hqc_rng_default(void);
+hqc_rng *hqc_rng_bind(hqc_rng *rng);
+hqc_rng *hqc_rng_current(void);
+
+#endif
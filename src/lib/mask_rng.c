@@ -0,0 +1,216 @@
+/**
+ * @file mask_rng.c
+ * @brief Buffered source of the random masks of the masked routines
+ *
+ * The masks are read from a buffer of MASK_RNG_BUFFER_BYTES bytes, refilled in bulk when it runs out. Every refill
+ * draws a fresh 32-byte key from shake_prng and expands it with a fast keystream: AES-256 in counter mode with
+ * AES-NI where the CPU has it, 8 SHAKE-256 streams with the MASK_RNG_DOMAIN domain, squeezed side by side with the
+ * multi-lane permutation of fips202x4.c, otherwise. The masks never reach the
+ * outputs, they only need to be unpredictable, so the keystream does not have to match across the backends.
+ * The buffer and the PRNG the keys come from are the ones of a context of hqc_rng.c: mask_rng draws from the
+ * context bound to the calling thread.
+ */
+
+#include <string.h>
+
+#include "mask_rng.h"
+#include "domains.h"
+#include "fips202x4.h"
+#include "hqc_rng.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+    #define MASK_RNG_AESNI
+    #include <immintrin.h>
+#endif
+
+
+/**
+ * Backend of the keystream, resolved: MASK_RNG_AUTO only until the first refill or mask_rng_set_backend. The
+ * threads of the mask pool read it alongside the callers, hence the atomic accesses.
+ */
+static mask_rng_backend_t mask_rng_backend = MASK_RNG_AUTO;
+
+
+/**
+ * @brief Fills the buffer with the SHAKE-256 keystreams of a key, an eighth of the buffer per lane of an 8-lane
+ * state, the lanes separated by their index absorbed after the domain
+ *
+ * @param[out] output Pointer to the buffer, MASK_RNG_BUFFER_BYTES bytes
+ * @param[in] key Pointer to the key, MASK_RNG_KEY_BYTES bytes
+ */
+static void mask_rng_fill_shake(uint8_t *output, const uint8_t *key) {
+    uint8_t domain = MASK_RNG_DOMAIN;
+    uint8_t index[8];
+    const uint8_t *keys[8], *domains[8], *indices[8];
+    uint8_t *outputs[8];
+    shake256x8incctx state;
+
+    for (size_t j = 0; j < 8; j++) {
+        index[j] = (uint8_t) j;
+        keys[j] = key;
+        domains[j] = &domain;
+        indices[j] = &index[j];
+        outputs[j] = output + j * (MASK_RNG_BUFFER_BYTES / 8);
+    }
+    shake256x8_inc_init(&state);
+    shake256x8_inc_absorb(&state, keys, MASK_RNG_KEY_BYTES);
+    shake256x8_inc_absorb(&state, domains, 1);
+    shake256x8_inc_absorb(&state, indices, 1);
+    shake256x8_inc_finalize(&state);
+    shake256x8_inc_squeeze(outputs, MASK_RNG_BUFFER_BYTES / 8, &state);
+}
+
+
+#ifdef MASK_RNG_AESNI
+/**
+ * @brief One step of the AES-256 key schedule: the previous round key of the same parity XORed with its shifts and
+ * with the broadcast word of the key generation assist
+ */
+__attribute__((target("aes,sse2")))
+static inline __m128i aes256_expand_step(__m128i k, __m128i t) {
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    return _mm_xor_si128(k, t);
+}
+
+#define AES256_EXPAND(rk, i, rcon)                                                                               \
+    do {                                                                                                         \
+        (rk)[2 * (i)] = aes256_expand_step((rk)[2 * (i) - 2],                                                    \
+                                           _mm_shuffle_epi32(_mm_aeskeygenassist_si128((rk)[2 * (i) - 1], rcon), 0xff)); \
+        if ((i) < 7)                                                                                             \
+            (rk)[2 * (i) + 1] = aes256_expand_step((rk)[2 * (i) - 1],                                            \
+                                                   _mm_shuffle_epi32(_mm_aeskeygenassist_si128((rk)[2 * (i)], 0), 0xaa)); \
+    } while (0)
+
+
+/**
+ * @brief Fills the buffer with AES-256 in counter mode, 8 blocks at a time, the counter starting from zero
+ *
+ * @param[out] output Pointer to the buffer, MASK_RNG_BUFFER_BYTES bytes
+ * @param[in] key Pointer to the key, MASK_RNG_KEY_BYTES bytes
+ */
+__attribute__((target("aes,sse2")))
+static void mask_rng_fill_aes(uint8_t *output, const uint8_t *key) {
+    __m128i rk[15], b[8];
+    const __m128i one = _mm_set_epi64x(0, 1);
+    __m128i ctr = _mm_setzero_si128();
+
+    rk[0] = _mm_loadu_si128((const __m128i *) key);
+    rk[1] = _mm_loadu_si128((const __m128i *) (key + 16));
+    AES256_EXPAND(rk, 1, 0x01);
+    AES256_EXPAND(rk, 2, 0x02);
+    AES256_EXPAND(rk, 3, 0x04);
+    AES256_EXPAND(rk, 4, 0x08);
+    AES256_EXPAND(rk, 5, 0x10);
+    AES256_EXPAND(rk, 6, 0x20);
+    AES256_EXPAND(rk, 7, 0x40);
+
+    for (size_t p = 0; p < MASK_RNG_BUFFER_BYTES; p += 8 * 16) {
+        for (size_t k = 0; k < 8; k++) {
+            b[k] = _mm_xor_si128(ctr, rk[0]);
+            ctr = _mm_add_epi64(ctr, one);
+        }
+        for (size_t r = 1; r < 14; r++) {
+            for (size_t k = 0; k < 8; k++) {
+                b[k] = _mm_aesenc_si128(b[k], rk[r]);
+            }
+        }
+        for (size_t k = 0; k < 8; k++) {
+            _mm_storeu_si128((__m128i *) (output + p + 16 * k), _mm_aesenclast_si128(b[k], rk[14]));
+        }
+    }
+}
+#endif
+
+
+/**
+ * @brief Backend that runs for a requested one: AES when AUTO and the CPU has AES-NI, SHAKE for AUTO or AES
+ * otherwise
+ */
+static mask_rng_backend_t mask_rng_resolve(mask_rng_backend_t backend) {
+    int aes = 0;
+
+#ifdef MASK_RNG_AESNI
+    __builtin_cpu_init();
+    aes = __builtin_cpu_supports("aes");
+#endif
+    if (backend == MASK_RNG_AUTO) {
+        backend = aes ? MASK_RNG_AES : MASK_RNG_SHAKE;
+    }
+    if (backend == MASK_RNG_AES && !aes) {
+        backend = MASK_RNG_SHAKE;
+    }
+    return backend;
+}
+
+
+
+/**
+ * @brief Sets the keystream of the masks
+ *
+ * MASK_RNG_AUTO picks AES when the CPU has AES-NI, SHAKE otherwise; a backend the CPU does not support falls back
+ * to SHAKE. The masks already in the buffer of the calling thread's context are discarded.
+ *
+ * @param[in] backend Keystream to use
+ * @returns the keystream actually used
+ */
+mask_rng_backend_t mask_rng_set_backend(mask_rng_backend_t backend) {
+    backend = mask_rng_resolve(backend);
+#ifdef MASK_RNG_AESNI
+    __atomic_store_n(&mask_rng_backend, backend, __ATOMIC_RELAXED);
+#else
+    mask_rng_backend = backend;
+#endif
+    mask_rng_reset();
+    return backend;
+}
+
+
+
+/**
+ * @brief Expands a key with the keystream of the current backend, without touching the buffer of mask_rng
+ *
+ * Unlike mask_rng it keeps no state, so that other threads can produce masks from keys of their own.
+ *
+ * @param[out] output Pointer to the output, MASK_RNG_BUFFER_BYTES bytes
+ * @param[in] key Pointer to the key, MASK_RNG_KEY_BYTES bytes
+ */
+void mask_rng_expand(uint8_t *output, const uint8_t *key) {
+#ifdef MASK_RNG_AESNI
+    mask_rng_backend_t backend = __atomic_load_n(&mask_rng_backend, __ATOMIC_RELAXED);
+
+    // every thread resolves AUTO to the same backend, so the first ones may all store it
+    if (backend == MASK_RNG_AUTO) {
+        backend = mask_rng_resolve(MASK_RNG_AUTO);
+        __atomic_store_n(&mask_rng_backend, backend, __ATOMIC_RELAXED);
+    }
+    if (backend == MASK_RNG_AES) {
+        mask_rng_fill_aes(output, key);
+        return;
+    }
+#endif
+    mask_rng_fill_shake(output, key);
+}
+
+
+
+/**
+ * @brief Discards the masks left in the buffer of the context bound to the calling thread, so that the next ones are
+ * derived from the current state of its PRNG
+ */
+void mask_rng_reset(void) {
+    hqc_rng_masks_reset(hqc_rng_current());
+}
+
+
+
+/**
+ * @brief Random bytes for the masks, from the context bound to the calling thread
+ *
+ * @param[out] output Pointer to output
+ * @param[in] outlen length of output in bytes
+ */
+void mask_rng(uint8_t *output, size_t outlen) {
+    hqc_rng_masks(hqc_rng_current(), output, outlen);
+}
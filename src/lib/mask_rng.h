@@ -0,0 +1,40 @@
+#ifndef MASK_RNG_H
+#define MASK_RNG_H
+
+/**
+ * @file mask_rng.h
+ * @brief Header file of mask_rng.c
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes of masks generated by one refill of the buffer, a multiple of 128: smaller on the board, whose RAM every
+// context holds one of
+#ifndef MASK_RNG_BUFFER_BYTES
+    #ifdef CROSSCOMPILE
+        #define MASK_RNG_BUFFER_BYTES 1024
+    #else
+        #define MASK_RNG_BUFFER_BYTES 8192
+    #endif
+#endif
+#if MASK_RNG_BUFFER_BYTES % 128 != 0
+    #error INVALID MASK_RNG_BUFFER_BYTES
+#endif
+#define MASK_RNG_KEY_BYTES 32 /*!< Bytes of the key of a refill */
+
+/**
+ * Keystreams available for the masks
+ */
+typedef enum {
+    MASK_RNG_AUTO = 0,
+    MASK_RNG_SHAKE,
+    MASK_RNG_AES
+} mask_rng_backend_t;
+
+mask_rng_backend_t mask_rng_set_backend(mask_rng_backend_t backend);
+void mask_rng_reset(void);
+void mask_rng(uint8_t *output, size_t outlen);
+void mask_rng_expand(uint8_t *output, const uint8_t *key);
+
+#endif
@@ -34,3 +34,63 @@ void shake256_512_ds(shake256incctx *state, uint8_t *output, const uint8_t *inpu
     /* Squeeze output */
     shake256_inc_squeeze(output, 512/8, state);
 }
+
+
+
+/**
+ * @brief SHAKE-256 with domain separation on up to 4 inputs of the same length, with the permutations of a 4-lane
+ * state
+ *
+ * Every lane outputs the bytes shake256_512_ds would. The lanes whose input is NULL are not computed.
+ *
+ * @param[out] output Pointers to the outputs, 64 bytes each
+ * @param[in] input Pointers to the inputs
+ * @param[in] inlen length of the inputs in bytes
+ * @param[in] domain bytes for domain separation, one per lane
+ */
+void shake256_512_ds_x4(uint8_t *const output[4], const uint8_t *const input[4], size_t inlen, const uint8_t domain[4]) {
+    shake256x4incctx state;
+    const uint8_t *domains[4];
+    uint8_t *outputs[4];
+
+    for (size_t j = 0; j < 4; j++) {
+        domains[j] = input[j] == NULL ? NULL : &domain[j];
+        outputs[j] = input[j] == NULL ? NULL : output[j];
+    }
+
+    shake256x4_inc_init(&state);
+    shake256x4_inc_absorb(&state, input, inlen);
+    shake256x4_inc_absorb(&state, domains, 1);
+    shake256x4_inc_finalize(&state);
+    shake256x4_inc_squeeze(outputs, 512/8, &state);
+}
+
+
+
+/**
+ * @brief SHAKE-256 with domain separation on up to 2 inputs of the same length, with the permutations of a 2-lane
+ * state
+ *
+ * Every lane outputs the bytes shake256_512_ds would. The lanes whose input is NULL are not computed.
+ *
+ * @param[out] output Pointers to the outputs, 64 bytes each
+ * @param[in] input Pointers to the inputs
+ * @param[in] inlen length of the inputs in bytes
+ * @param[in] domain bytes for domain separation, one per lane
+ */
+void shake256_512_ds_x2(uint8_t *const output[2], const uint8_t *const input[2], size_t inlen, const uint8_t domain[2]) {
+    shake256x2incctx state;
+    const uint8_t *domains[2];
+    uint8_t *outputs[2];
+
+    for (size_t j = 0; j < 2; j++) {
+        domains[j] = input[j] == NULL ? NULL : &domain[j];
+        outputs[j] = input[j] == NULL ? NULL : output[j];
+    }
+
+    shake256x2_inc_init(&state);
+    shake256x2_inc_absorb(&state, input, inlen);
+    shake256x2_inc_absorb(&state, domains, 1);
+    shake256x2_inc_finalize(&state);
+    shake256x2_inc_squeeze(outputs, 512/8, &state);
+}
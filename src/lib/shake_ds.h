@@ -9,8 +9,11 @@
 #include <stdint.h>
 
 #include "fips202.h"
+#include "fips202x4.h"
 #include "domains.h"
 
 void shake256_512_ds(shake256incctx *state, uint8_t *output, const uint8_t *input, size_t inlen, uint8_t domain);
+void shake256_512_ds_x2(uint8_t *const output[2], const uint8_t *const input[2], size_t inlen, const uint8_t domain[2]);
+void shake256_512_ds_x4(uint8_t *const output[4], const uint8_t *const input[4], size_t inlen, const uint8_t domain[4]);
 
 #endif
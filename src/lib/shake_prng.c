@@ -2,17 +2,19 @@
 /**
  * @file shake_prng.c
  * @brief Implementation of SHAKE-256 based PRNG and seedexpander
+ *
+ * shake_prng_init and shake_prng work on the default context of hqc_rng.c, for the callers that do not pass one.
  */
 
 #include "shake_prng.h"
 
-shake256incctx shake_prng_state;
-
 
 /**
  * @brief SHAKE-256 with incremental API and domain separation
  *
  * Derived from function SHAKE_256 in fips202.c
+ * Seeds the default context of hqc_rng.c, whose buffered masks are discarded, so that the next ones derive from the
+ * new state.
  *
  * @param[in] entropy_input Pointer to input entropy bytes
  * @param[in] personalization_string Pointer to the personalization string
@@ -20,18 +22,13 @@ shake256incctx shake_prng_state;
  * @param[in] perlen Length of the personalization string in bytes
  */
 void shake_prng_init(uint8_t *entropy_input, uint8_t *personalization_string, uint32_t enlen, uint32_t perlen) {
-    uint8_t domain = PRNG_DOMAIN;
-    shake256_inc_init(&shake_prng_state);
-    shake256_inc_absorb(&shake_prng_state, entropy_input, enlen);
-    shake256_inc_absorb(&shake_prng_state, personalization_string, perlen);
-    shake256_inc_absorb(&shake_prng_state, &domain, 1);
-    shake256_inc_finalize(&shake_prng_state);
+    hqc_rng_seed_default(entropy_input, personalization_string, enlen, perlen);
 }
 
 
 
 /**
- * @brief A SHAKE-256 based PRNG
+ * @brief A SHAKE-256 based PRNG, drawing from the default context of hqc_rng.c
  *
  * Derived from function SHAKE_256 in fips202.c
  *
@@ -39,7 +36,7 @@ void shake_prng_init(uint8_t *entropy_input, uint8_t *personalization_string, ui
  * @param[in] outlen length of output in bytes
  */
 void shake_prng(uint8_t *output, uint32_t outlen) {
-    shake256_inc_squeeze(output, outlen, &shake_prng_state);
+    hqc_rng_bytes(hqc_rng_default(), output, outlen);
 }
 
 
@@ -63,26 +60,45 @@ void seedexpander_init(seedexpander_state *state, const uint8_t *seed, uint32_t
 
 
 
+/**
+ * @brief Initialiase up to four SHAKE-256 based seedexpanders side by side
+ *
+ * The seedexpanders are the ones of seedexpander_init, but are absorbed and squeezed for their first block with a
+ * single 4-lane permutation.
+ *
+ * @param[out] state Pointers to the states, NULL for the lanes not used
+ * @param[in] seed Pointers to the seeds, NULL for the lanes not used
+ * @param[in] seedlen The seed bytes length, the same for all
+ */
+void seedexpander_init_x4(seedexpander_state *const state[4], const uint8_t *const seed[4], uint32_t seedlen) {
+    uint8_t domain = SEEDEXPANDER_DOMAIN;
+    const uint8_t *domains[4];
+    shake256x4incctx states;
+
+    for (size_t j = 0; j < 4; j++) {
+        domains[j] = seed[j] == NULL ? NULL : &domain;
+    }
+    shake256x4_inc_init(&states);
+    shake256x4_inc_absorb(&states, seed, seedlen);
+    shake256x4_inc_absorb(&states, domains, 1);
+    shake256x4_inc_finalize(&states);
+    shake256x4_inc_split(state, &states);
+}
+
+
+
 /**
  * @brief A SHAKE-256 based seedexpander
  *
  * Derived from function SHAKE_256 in fips202.c
- * Squeezes Keccak state by 64-bit blocks (hardware version compatibility)
+ * Squeezes Keccak state by 64-bit blocks (hardware version compatibility): the bytes of the last block past
+ * <b>outlen</b> are discarded. The blocks are copied from the Keccak state, which buffers the rest of the current rate
+ * block between calls, straight to <b>output</b>, so that it can be the storage of a vector.
  *
  * @param[out] state Internal state of SHAKE
  * @param[out] output The XOF data
  * @param[in] outlen Number of bytes to return
  */
 void seedexpander(seedexpander_state *state, uint8_t *output, uint32_t outlen) {
-    const uint8_t bsize = sizeof(uint64_t);
-    const uint8_t remainder = outlen % bsize;
-    uint8_t tmp[sizeof(uint64_t)];
-    shake256_inc_squeeze(output, outlen - remainder, state);
-    if (remainder != 0) {
-      shake256_inc_squeeze(tmp, bsize, state);
-      output += outlen - remainder;
-      for (uint8_t i = 0; i < remainder; i++){
-        output[i] = tmp[i];
-      }
-    }
+    shake256_inc_squeeze_lanes(output, outlen, state);
 }
@@ -10,12 +10,15 @@
 
 #include "domains.h"
 #include "fips202.h"
+#include "fips202x4.h"
+#include "hqc_rng.h"
 
 typedef shake256incctx seedexpander_state;
 
 void shake_prng_init(uint8_t *entropy_input, uint8_t *personalization_string, uint32_t enlen, uint32_t perlen);
 void shake_prng(uint8_t *output, uint32_t outlen);
 void seedexpander_init(seedexpander_state *state, const uint8_t *seed, uint32_t seedlen);
+void seedexpander_init_x4(seedexpander_state *const state[4], const uint8_t *const seed[4], uint32_t seedlen);
 void seedexpander(seedexpander_state *state, uint8_t *output, uint32_t outlen);
 
 #endif